@@ -10,6 +10,14 @@ struct vec2 {
 	float y;
 };
 
+//Per eye gaze points, with how much the tracker trusts each one from 0 (eye lost) to 1
+struct binocular_gaze {
+	vec2 left;
+	vec2 right;
+	float left_confidence;
+	float right_confidence;
+};
+
 class GazePointDevice
 {
 public:
@@ -49,4 +57,7 @@ extern "C" EYE_TRACKER_API const char* Get_Device_Name();
 
 extern "C" EYE_TRACKER_API vec2 Get_Eye_Position();
 
+//Optional, devices that track each eye separately export this as well
+extern "C" EYE_TRACKER_API binocular_gaze Get_Binocular_Eye_Position();
+
 extern "C" EYE_TRACKER_API void Eye_Shutdown();
\ No newline at end of file
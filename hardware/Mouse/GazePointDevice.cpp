@@ -79,6 +79,14 @@ vec2 Get_Eye_Position() {
 	return GazePointDevice::getInstance()->getEyePosition();
 }
 
+binocular_gaze Get_Binocular_Eye_Position() {
+	//Both eyes follow the cursor
+	binocular_gaze gaze;
+	gaze.left = gaze.right = GazePointDevice::getInstance()->getEyePosition();
+	gaze.left_confidence = gaze.right_confidence = 1.0f;
+	return gaze;
+}
+
 void Eye_Shutdown() {
 	GazePointDevice::getInstance()->shutdown();
 }
\ No newline at end of file
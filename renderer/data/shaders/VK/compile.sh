@@ -0,0 +1,8 @@
+#!/bin/sh
+#Compiles the GLSL sources in src/ to the SPIR-V files the Vulkan backend loads
+#Needs glslangValidator from the Vulkan SDK on the path
+cd "$(dirname "$0")" || exit 1
+
+for shader in src/*.vert src/*.frag; do
+  glslangValidator -V "$shader" -o "$(basename "$shader")" || exit 1
+done
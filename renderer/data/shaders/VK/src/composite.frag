@@ -0,0 +1,18 @@
+#version 450 core
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (location = 1) in vec2 fragTexCoords;
+layout (location = 0) out vec4 fragColor;
+layout (set = 1, binding = 0) uniform sampler2D colorTexture;
+
+//xy = gaze point in pixels, z = layer radius in pixels, w = blend width in pixels
+layout (push_constant) uniform composite_data {
+	layout (offset = 64) vec4 blendData;
+};
+
+void main() {
+    vec4 color = texture(colorTexture, fragTexCoords);
+    float dist = length(gl_FragCoord.xy - blendData.xy);
+    float fade = 1.0f - smoothstep(blendData.z - blendData.w, blendData.z, dist);
+    fragColor = vec4(color.rgb, color.a * fade);
+}
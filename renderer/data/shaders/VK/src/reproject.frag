@@ -0,0 +1,35 @@
+#version 450 core
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (location = 1) in vec2 fragTexCoords;
+layout (location = 0) out vec4 fragColor;
+
+//Maps the NDC + depth of the last rendered base pass to the current clip space
+layout (set = 0, binding = 0) uniform reprojection {
+    mat4 currentFromHistory;
+};
+layout (set = 0, binding = 6) uniform sampler2D historyDepth;
+layout (set = 1, binding = 0) uniform sampler2D colorTexture;
+
+//xy = part of the framebuffer the base pass rendered to, in texture coordinates
+layout (push_constant) uniform reproject_data {
+	layout (offset = 64) vec4 reprojectData;
+};
+
+vec2 ToHistoryUV(vec2 ndc) {
+    return clamp(ndc * 0.5f + 0.5f, vec2(0.0f), vec2(1.0f)) * reprojectData.xy;
+}
+
+void main() {
+    vec2 target = (fragTexCoords / reprojectData.xy) * 2.0f - 1.0f;
+
+    //Only the old depth is known, so search for the history pixel that lands on this one
+    vec2 source = target;
+    for (int i = 0; i < 3; i++) {
+        float depth = texture(historyDepth, ToHistoryUV(source)).r;
+        vec4 current = currentFromHistory * vec4(source, depth, 1.0f);
+        source += target - current.xy / current.w;
+    }
+
+    fragColor = texture(colorTexture, ToHistoryUV(source));
+}
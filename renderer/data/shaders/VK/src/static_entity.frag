@@ -16,6 +16,8 @@ struct DirectionalLight {
   vec4 m_DiffuseColor;
   vec4 m_SpecularColor;
   mat4 m_LightSpaceMatrix;
+  mat4 m_GazeLightSpaceMatrix;
+  vec4 m_GazeShadowRect; //xy = offset, zw = scale of the gaze cascade in the shadow map, zero scale when there is none
 };
 
 #define NUM_POINT_LIGHTS 18
@@ -70,6 +72,16 @@ float CalcShadow() {
   vec3 projCoords = FragPosLightSpace.xyz / FragPosLightSpace.w;
   projCoords.xy = projCoords.xy * 0.5 + 0.5;
 
+  //Use the sharper gaze cascade when it covers this fragment, keeping a texel clear of its edge
+  if (dLight.m_GazeShadowRect.z > 0.0) {
+    vec4 gazeSpace = dLight.m_GazeLightSpaceMatrix * vec4(FragPos, 1.0);
+    vec3 gazeCoords = gazeSpace.xyz / gazeSpace.w;
+    vec2 margin = 2.0 / (vec2(textureSize(shadowMap, 0)) * dLight.m_GazeShadowRect.zw);
+    if (all(lessThan(abs(gazeCoords.xy), vec2(1.0) - margin))) {
+      projCoords = vec3((gazeCoords.xy * 0.5 + 0.5) * dLight.m_GazeShadowRect.zw + dLight.m_GazeShadowRect.xy, gazeCoords.z);
+    }
+  }
+
   float closestDepth = texture(shadowMap, projCoords.xy).r;
   float currentDepth = projCoords.z;
 
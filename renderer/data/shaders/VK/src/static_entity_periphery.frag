@@ -0,0 +1,32 @@
+#version 450 core
+#extension GL_ARB_separate_shader_objects : enable
+
+//Cheap variant of static_entity.frag for the periphery, only ambient and unshadowed directional light
+
+layout (location = 0) out vec4 outColor;
+
+layout (location = 0) in vec3 FragPos;
+layout (location = 3) in vec3 FragNormal;
+layout (location = 2) in vec3 FragColor;
+layout (location = 4) in vec4 FragPosLightSpace;
+
+struct DirectionalLight {
+  vec4 m_Direction;
+  vec4 m_AmbientColor;
+  vec4 m_DiffuseColor;
+  vec4 m_SpecularColor;
+  mat4 m_LightSpaceMatrix;
+};
+
+layout(std140, binding = 1) uniform lighting {
+    DirectionalLight dLight;
+};
+
+void main(){
+  vec3 norm = normalize(FragNormal);
+  vec3 lightDir = normalize(-dLight.m_Direction.xyz);
+  float strength = max(dot(norm, lightDir), 0.0);
+  vec3 color = dLight.m_DiffuseColor.xyz * strength * FragColor;
+  color += dLight.m_AmbientColor.xyz;
+  outColor =  vec4(color, 1.0f);
+}
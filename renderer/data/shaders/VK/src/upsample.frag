@@ -0,0 +1,48 @@
+#version 450 core
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (location = 1) in vec2 fragTexCoords;
+layout (location = 0) out vec4 fragColor;
+
+layout (set = 0, binding = 6) uniform sampler2D baseDepth;
+layout (set = 1, binding = 0) uniform sampler2D colorTexture;
+
+//xy = part of the framebuffer the base pass rendered to, in texture coordinates
+//z = depth scale of the projection (proj[2][2]), w = how strongly depth differences cut the filter
+layout (push_constant) uniform upsample_data {
+	layout (offset = 64) vec4 upsampleData;
+};
+
+//Depth buffer values offset by proj[2][2] are proportional to 1 / view depth
+float InverseDepth(ivec2 texel) {
+    return texelFetch(baseDepth, texel, 0).r + upsampleData.z;
+}
+
+void main() {
+    vec2 size = vec2(textureSize(colorTexture, 0));
+    ivec2 maxTexel = max(ivec2(upsampleData.xy * size) - 1, ivec2(0));
+
+    vec2 position = fragTexCoords * size - 0.5f;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - floor(position);
+
+    //The closest low resolution sample decides which surface this pixel belongs to
+    ivec2 nearest = clamp(ivec2(floor(position + 0.5f)), ivec2(0), maxTexel);
+    float reference = InverseDepth(nearest);
+
+    //Bilinear weights, reduced for samples on a different surface
+    vec4 color = vec4(0.0f);
+    float totalWeight = 0.0f;
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 2; x++) {
+            ivec2 texel = clamp(base + ivec2(x, y), ivec2(0), maxTexel);
+            float bilinear = (x == 1 ? f.x : 1.0f - f.x) * (y == 1 ? f.y : 1.0f - f.y);
+            float difference = abs(InverseDepth(texel) - reference) / max(abs(reference), 1e-6f);
+            float weight = bilinear * exp(-upsampleData.w * difference) + 1e-5f;
+            color += weight * texelFetch(colorTexture, texel, 0);
+            totalWeight += weight;
+        }
+    }
+
+    fragColor = color / totalWeight;
+}
@@ -1,6 +1,7 @@
 #include "MeshComponent.h"
 #include "../Renderer/Frontend.h"
 #include "../Log.h"
+#include "../Config.h"
 
 MeshComponent::MeshComponent() {
   mVisible = true;
@@ -15,7 +16,12 @@ void MeshComponent::LoadMeshData(const std::string & file) {
   Log::LogInfo("Loaded Mesh: " + file);
 }
 void MeshComponent::LoadShader(const std::string &vertexShaderFile, const std::string &fragmentShaderFile) {
-  mModel.mShader = RenderFrontend::LoadShader(vertexShaderFile, fragmentShaderFile, DRAW_STAGE::WORLD);
+  //The periphery variant always builds in the background since the full shader can stand in for it
+  //AsyncShaders also builds the full shader in the background, the mesh isn't drawn until one of them is ready
+  const bool asyncShaders = Config::OptionExists("AsyncShaders") && Config::GetOptionInt("AsyncShaders") == 1;
+  mModel.mShader = asyncShaders ? RenderFrontend::LoadShaderAsync(vertexShaderFile, fragmentShaderFile, DRAW_STAGE::WORLD)
+                                : RenderFrontend::LoadShader(vertexShaderFile, fragmentShaderFile, DRAW_STAGE::WORLD);
+  mModel.mPeripheralShader = RenderFrontend::LoadShaderVariant(vertexShaderFile, fragmentShaderFile, "periphery", DRAW_STAGE::WORLD, true);
 }
 void MeshComponent::SetTexture(const std::string &textureFile) {
   Texture *t = RenderFrontend::LoadTexture(textureFile);
@@ -26,34 +26,39 @@ EngineCore::~EngineCore() {
 void EngineCore::BeginGame() {
   state = EngineState ::GAME_RUNNING;
   while (state == EngineState::GAME_RUNNING) {
+    RunFrame();
+  }
+}
+void EngineCore::RunFrame() {
+  lastFrameTime = currentFrameTime;
 
-    lastFrameTime = currentFrameTime;
-
-    currentFrameTime = SDL_GetPerformanceCounter();
-
-    deltaTime = currentFrameTime - lastFrameTime;
-
-    //Run events
-    deltaTime /= SDL_GetPerformanceFrequency();
-    if(deltaTime > 1){
-      deltaTime = 0.0f;
-    }
-    Input::PollInputs();
-    if(Input::GetClose()){
-      Quit();
-    }
+  currentFrameTime = SDL_GetPerformanceCounter();
 
-    RenderFrontend::BeginFrame();
-    Update(deltaTime);
-    RenderFrontend::EndFrame();
+  deltaTime = currentFrameTime - lastFrameTime;
 
+  //Run events
+  deltaTime /= SDL_GetPerformanceFrequency();
+  if(deltaTime > 1){
+    deltaTime = 0.0f;
+  }
+  Input::PollInputs();
+  if(Input::GetClose()){
+    Quit();
   }
+
+  RenderFrontend::BeginFrame();
+  Update(deltaTime);
+  RenderFrontend::EndFrame();
 }
 void EngineCore::Quit() {
   state = EngineState::GAME_SHUTDOWN;
 }
 
 void EngineCore::SDL_Startup() {
+  //Headless runs have no display to open, SDL's dummy video driver keeps input and timing working without one
+  if (Config::OptionExists("Headless") && Config::GetOptionInt("Headless") == 1) {
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+  }
   SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER);
 }
 
@@ -25,6 +25,12 @@ class EngineCore {
   void BeginGame();
   void Quit();
 
+  /**
+   * Runs a single frame of the game loop: input, object updates and rendering
+   * BeginGame calls this until Quit, tools can call it directly to step frames themselves
+   */
+  void RunFrame();
+
   static EngineCore *GetEngine();
 
   double deltaTime;
@@ -14,6 +14,10 @@ void GameObject::Collision(GameObject * other) {
 void GameObject::Input(const InputCallbackData &inputData) {
 }
 
+void GameObject::RemoveComponents() {
+  mComponents.clear();
+}
+
 void GameObject::Destroy() {
   EngineCore::GetEngine()->DestroyObject(this);
 }
@@ -21,6 +21,12 @@ public:
     return component;
   }
 
+protected:
+  /**
+   * Drops every component, they are destroyed once nothing else holds them
+   */
+  void RemoveComponents();
+
 private:
   std::vector<std::shared_ptr<Component>> mComponents;
 };
@@ -44,6 +44,10 @@ void Map::LoadMap(const std::string &mapPath, const bool relativeToDataFolder) {
 
   mapFile >> mapJson;
 
+  //Drop the previous map's entities and lighting
+  RemoveComponents();
+  mDirectionalLight = AddComponent<DirectionalLightComponent>();
+
   auto entities = mapJson.at("entities").get<std::vector<json>>();
 
   for (auto &entity: entities) {
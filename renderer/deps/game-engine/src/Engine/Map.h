@@ -19,7 +19,7 @@ public:
   void Update(float deltaTime);
 
   /**
-   * Parses a map file and transitions the game to that map
+   * Parses a map file and transitions the game to that map, replacing any map loaded before
    * @param[in] mapPath The map file to load
    * @param[in] relativeToDataFolder - True if mapPath is relative to the data folder, false if relative to the executable
    */
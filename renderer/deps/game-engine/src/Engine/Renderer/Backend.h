@@ -22,10 +22,44 @@ enum class DRAW_STAGE {
 class Drawable {
 public:
   Shader* mShader;
+  Shader* mPeripheralShader;
   Texture* mTexture;
   Mat4 mTransformMatrix;
   VertexBuffer* mVBuffer;
   u32 mNumFaces;
+  Vec3 mBoundsCenter;
+  float mBoundsRadius;
+  u32 mNumLODs;
+  MeshLOD mLODs[MAX_MESH_LODS];
+};
+
+//Timings of the last finished frame, in microseconds
+struct FrameTimings {
+  float mCPUDraw;
+  //CPU time spent recording each pass
+  float mCPUShadow;
+  float mCPUWorld;
+  float mCPUFoveated;
+  float mCPUUI;
+  float mCPUPresent;
+  float mGPUTotal;
+  float mGPUShadow;
+  float mGPUWorld;
+  float mGPUFoveated;
+  float mGPUUI;
+  float mGPUPresent;
+  //How many frames older the GPU times are than the CPU time
+  u32 mGPULatency;
+};
+
+//A finished frame read back from the GPU, before the debug UI is drawn over it
+struct FrameCapture {
+  u32 mWidth;
+  u32 mHeight;
+  //Centre of the foveated region, in pixels
+  Vec2 mGaze;
+  //8 bit RGBA, rows from the top of the screen
+  std::vector<u8> mPixels;
 };
 
 class RenderBackend {
@@ -36,6 +70,8 @@ public:
   virtual const Model LoadModel(const std::vector<Vertex> vertices, const std::vector<u32> indices) = 0;
   virtual Texture* LoadTexture(const unsigned char* data, const int width, const int height, const int numChannels) = 0;
   virtual Shader* CreateShader(const std::vector<char> vertexProgram, const std::vector<char> fragmentProgram, const DRAW_STAGE stage) = 0;
+  virtual Shader* CreateShaderAsync(const std::vector<char> vertexProgram, const std::vector<char> fragmentProgram, const DRAW_STAGE stage) = 0;
+  virtual bool IsShaderReady(Shader* shader) = 0;
   virtual void SetFrameBufferModel(const Model &model) = 0;
   virtual void SetFrameBufferShader(Shader* shader, const DRAW_STAGE stage) = 0;
   virtual void Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4 &userData, const std::vector<Drawable> &scene, const std::vector<Drawable> &ui, const LightData& lights) = 0;
@@ -49,4 +85,10 @@ public:
 
   virtual std::string GetDeviceName() = 0;
   virtual u64 GetUsedVRAM() = 0;
+  virtual FrameTimings GetFrameTimings() = 0;
+
+  virtual void SetFoveationEnabled(const bool enabled) = 0;
+  virtual void ResetTemporalState() = 0;
+  virtual void RequestFrameCapture() = 0;
+  virtual bool GetFrameCapture(FrameCapture &capture) = 0;
 };
\ No newline at end of file
@@ -1,15 +1,46 @@
 #include "GazePoint.h"
+#include "GazeTrace.h"
 #include <cmath>
+#include <algorithm>
 #include <SDL_loadso.h>
+#include <SDL_timer.h>
 #include "../../../Log.h"
 #include <filesystem>
 
 std::vector<GazePointDevice> GazePointManager::m_Devices;
 int GazePointManager::m_DeviceIndex = 0;
+std::vector<GazeSample> GazePointManager::m_Samples(32);
+int GazePointManager::m_SampleHead = 0;
+int GazePointManager::m_SampleCount = 0;
+BinocularGaze GazePointManager::m_Binocular = {};
+bool GazePointManager::m_Paused = false;
+GAZE_PREDICTION GazePointManager::m_Prediction = GAZE_PREDICTION::NONE;
 
 const std::string TRACKER_FOLDER = "hardware";
 
+//Only samples this recent are used for prediction, in seconds
+const double PREDICTION_WINDOW = 0.05;
+
+//Samples used for measuring the gaze velocity, in seconds
+//Kept short so saccades are picked up quickly, the latest two samples are used even when they're further apart than this
+const double VELOCITY_WINDOW = 0.02;
+
+//Furthest a prediction can look ahead, in seconds
+const float MAX_PREDICTION_TIME = 0.1f;
+
+//Furthest a prediction can move from the latest sample, in screen units
+const float MAX_PREDICTION_DISTANCE = 0.25f;
+
+//Below this total confidence both eyes are treated as lost and the last gaze point is held
+const float MIN_GAZE_CONFIDENCE = 0.1f;
+
 void GazePointManager::InitDevices() {
+  //Replayed traces don't need a tracker, so a missing folder isn't an error
+  if (!std::filesystem::is_directory(TRACKER_FOLDER)) {
+    Log::LogWarning("No " + TRACKER_FOLDER + " folder, gaze stays at the center of the screen");
+    return;
+  }
+
   //Iterate over all dlls in the folder
   std::filesystem::directory_iterator folder(TRACKER_FOLDER);
 
@@ -53,6 +84,12 @@ void GazePointManager::InitDevices() {
           Log::LogFatal("Could not load eye position function");
         }
 
+        device.binocular_position_func = (BinocularGaze(*) (void))SDL_LoadFunction(device.lib_file, "Get_Binocular_Eye_Position");
+
+        if (device.binocular_position_func != nullptr) {
+          Log::LogInfo(device.name + " tracks both eyes");
+        }
+
         m_Devices.push_back(device);
       }
     }
@@ -61,6 +98,9 @@ void GazePointManager::InitDevices() {
 }
 
 void GazePointManager::FreeDevices() {
+  if (m_Devices.empty()) {
+    return;
+  }
   m_Devices[m_DeviceIndex].shutdown_func();
   for (auto& device : m_Devices) {
     SDL_UnloadObject(device.lib_file);
@@ -70,16 +110,216 @@ void GazePointManager::FreeDevices() {
 void GazePointManager::SelectDevice(const int index) {
   static bool firstRun = true;
 
+  if (index < 0 || index >= (int)m_Devices.size()) {
+    return;
+  }
+
   if (!firstRun) {
     m_Devices[m_DeviceIndex].shutdown_func();
   }
   m_DeviceIndex = index;
   m_Devices[index].init_func();
   firstRun = false;
+
+  //Samples from the old device shouldn't be used to predict the new one
+  m_SampleCount = 0;
+}
+
+void GazePointManager::Update() {
+  if (m_Paused && m_SampleCount > 0) {
+    return;
+  }
+
+  GazeSample sample;
+  if (GazeTrace::IsReplaying()) {
+    sample = GazeTrace::GetReplayedSample(m_Binocular);
+  } else {
+    sample.point = ReadGazePoint();
+    sample.time = (double)SDL_GetPerformanceCounter() / SDL_GetPerformanceFrequency();
+  }
+
+  if (GazeTrace::IsRecording()) {
+    GazeTrace::RecordSample(sample, m_Binocular);
+  }
+
+  m_SampleHead = (m_SampleHead + 1) % m_Samples.size();
+  m_Samples[m_SampleHead] = sample;
+  if (m_SampleCount < (int)m_Samples.size()) {
+    m_SampleCount++;
+  }
+}
+
+void GazePointManager::SetPaused(const bool paused) {
+  m_Paused = paused;
 }
 
 GVec2 GazePointManager::GetGazePoint() {
-  return m_Devices[m_DeviceIndex].eye_position_func();
+  if (m_SampleCount == 0) {
+    return ReadGazePoint();
+  }
+  return m_Samples[m_SampleHead].point;
+}
+
+BinocularGaze GazePointManager::GetBinocularGaze() {
+  if (m_SampleCount == 0) {
+    ReadGazePoint();
+  }
+  return m_Binocular;
+}
+
+GVec2 GazePointManager::ReadGazePoint() {
+  if (m_Devices.empty()) {
+    GVec2 center = {0.5f, 0.5f};
+    m_Binocular = {center, center, 1.0f, 1.0f};
+    return center;
+  }
+
+  const GazePointDevice &device = m_Devices[m_DeviceIndex];
+  if (device.binocular_position_func == nullptr) {
+    GVec2 point = device.eye_position_func();
+    m_Binocular = {point, point, 1.0f, 1.0f};
+    return point;
+  }
+
+  m_Binocular = device.binocular_position_func();
+  const float left = std::max(0.0f, m_Binocular.leftConfidence);
+  const float right = std::max(0.0f, m_Binocular.rightConfidence);
+
+  //Hold the last point through blinks instead of jumping to whatever the tracker reports
+  if (left + right < MIN_GAZE_CONFIDENCE) {
+    if (m_SampleCount > 0) {
+      return m_Samples[m_SampleHead].point;
+    }
+    return device.eye_position_func();
+  }
+
+  GVec2 point;
+  point.x = (left * m_Binocular.left.x + right * m_Binocular.right.x) / (left + right);
+  point.y = (left * m_Binocular.left.y + right * m_Binocular.right.y) / (left + right);
+  return point;
+}
+
+GVec2 GazePointManager::GetPredictedGazePoint(const float latency) {
+  GVec2 latest = GetGazePoint();
+
+  if (m_Prediction == GAZE_PREDICTION::NONE || m_SampleCount < 3 || latency <= 0.0f) {
+    return latest;
+  }
+
+  //Least squares fit of the recent samples
+  double st[5];
+  double sx[3];
+  double sy[3];
+  int used = SumSamples(PREDICTION_WINDOW, 0, st, sx, sy);
+
+  if (used < 3) {
+    return latest;
+  }
+
+  const double h = std::min(latency, MAX_PREDICTION_TIME);
+  double px = latest.x;
+  double py = latest.y;
+
+  if (m_Prediction == GAZE_PREDICTION::ACCELERATION) {
+    //Solve the 3x3 normal equations for p(t) = a + bt + ct^2 with Cramer's rule
+    auto det3 = [](double a, double b, double c, double d, double e, double f, double g, double hh, double i) {
+      return a * (e * i - f * hh) - b * (d * i - f * g) + c * (d * hh - e * g);
+    };
+
+    const double det = det3(st[0], st[1], st[2], st[1], st[2], st[3], st[2], st[3], st[4]);
+    if (std::abs(det) > 1e-18) {
+      auto solve = [&](const double* s) {
+        double a = det3(s[0], st[1], st[2], s[1], st[2], st[3], s[2], st[3], st[4]) / det;
+        double b = det3(st[0], s[0], st[2], st[1], s[1], st[3], st[2], s[2], st[4]) / det;
+        double c = det3(st[0], st[1], s[0], st[1], st[2], s[1], st[2], st[3], s[2]) / det;
+        return a + b * h + c * h * h;
+      };
+      px = solve(sx);
+      py = solve(sy);
+    }
+  } else {
+    //Fit p(t) = a + bt
+    const double det = st[0] * st[2] - st[1] * st[1];
+    if (std::abs(det) > 1e-12) {
+      px = (st[2] * sx[0] - st[1] * sx[1] + (st[0] * sx[1] - st[1] * sx[0]) * h) / det;
+      py = (st[2] * sy[0] - st[1] * sy[1] + (st[0] * sy[1] - st[1] * sy[0]) * h) / det;
+    }
+  }
+
+  //Don't let noisy samples throw the prediction too far away
+  double dx = px - latest.x;
+  double dy = py - latest.y;
+  double dist = std::sqrt(dx * dx + dy * dy);
+  if (dist > MAX_PREDICTION_DISTANCE) {
+    dx *= MAX_PREDICTION_DISTANCE / dist;
+    dy *= MAX_PREDICTION_DISTANCE / dist;
+  }
+
+  GVec2 predicted;
+  predicted.x = (float)std::max(0.0, std::min(1.0, latest.x + dx));
+  predicted.y = (float)std::max(0.0, std::min(1.0, latest.y + dy));
+  return predicted;
+}
+
+GVec2 GazePointManager::GetGazeVelocity() {
+  GVec2 velocity = {0.0f, 0.0f};
+
+  double st[5];
+  double sx[3];
+  double sy[3];
+  int used = SumSamples(VELOCITY_WINDOW, 2, st, sx, sy);
+
+  //Slope of the least squares line through the samples
+  const double det = st[0] * st[2] - st[1] * st[1];
+  if (used >= 2 && std::abs(det) > 1e-12) {
+    velocity.x = (float)((st[0] * sx[1] - st[1] * sx[0]) / det);
+    velocity.y = (float)((st[0] * sy[1] - st[1] * sy[0]) / det);
+  }
+  return velocity;
+}
+
+int GazePointManager::SumSamples(const double window, const int minSamples, double st[5], double sx[3], double sy[3]) {
+  for (int n = 0; n < 5; n++) {
+    st[n] = 0.0;
+    if (n < 3) {
+      sx[n] = 0.0;
+      sy[n] = 0.0;
+    }
+  }
+
+  if (m_SampleCount == 0) {
+    return 0;
+  }
+
+  int used = 0;
+  const double latestTime = m_Samples[m_SampleHead].time;
+  for (int i = 0; i < m_SampleCount; i++) {
+    const GazeSample &sample = m_Samples[(m_SampleHead - i + m_Samples.size()) % m_Samples.size()];
+    const double t = sample.time - latestTime;
+    if (t < -window && i >= minSamples) {
+      break;
+    }
+
+    double tn = 1.0;
+    for (int n = 0; n < 5; n++) {
+      st[n] += tn;
+      if (n < 3) {
+        sx[n] += sample.point.x * tn;
+        sy[n] += sample.point.y * tn;
+      }
+      tn *= t;
+    }
+    used++;
+  }
+  return used;
+}
+
+void GazePointManager::SetPrediction(const GAZE_PREDICTION prediction) {
+  m_Prediction = prediction;
+}
+
+GAZE_PREDICTION GazePointManager::GetPrediction() {
+  return m_Prediction;
 }
 
 int GazePointManager::GetDeviceCount() {
@@ -8,6 +8,26 @@ struct GVec2 {
   float y;
 };
 
+//Per eye gaze points, with how much the tracker trusts each one from 0 (eye lost) to 1
+struct BinocularGaze {
+  GVec2 left;
+  GVec2 right;
+  float leftConfidence;
+  float rightConfidence;
+};
+
+//Gaze point along with the time it was read, in seconds
+struct GazeSample {
+  GVec2 point;
+  double time;
+};
+
+enum class GAZE_PREDICTION {
+  NONE,
+  LINEAR,
+  ACCELERATION
+};
+
 struct GazePointDevice {
   std::string name;
 
@@ -17,6 +37,9 @@ struct GazePointDevice {
   void(*shutdown_func)(void);
   GVec2(*eye_position_func)(void);
 
+  //Optional, nullptr for devices that only report one gaze point
+  BinocularGaze(*binocular_position_func)(void);
+
 
   //Might need sdl library handle here (should just be void*)
   void* lib_file;
@@ -31,8 +54,46 @@ public:
 
   static void SelectDevice(const int index);
 
+  /*!
+  * Reads and timestamps a new sample from the current device, should be called once per frame
+  */
+  static void Update();
+
+  /*!
+  * Stops taking new samples, so the gaze point and its prediction stay where they are until unpaused
+  * @param[in] paused Whether to keep the current samples
+  */
+  static void SetPaused(const bool paused);
+
+  /*!
+  * Gets the latest gaze sample, reading the device directly if Update hasn't been called yet
+  * @return The gaze point in 0 to 1 screen coordinates
+  */
   static GVec2 GetGazePoint();
 
+  /*!
+  * Extrapolates the recent gaze samples to estimate where the eye will be looking
+  * @param[in] latency Seconds from the latest sample until the frame is expected to be on screen
+  * @return The predicted gaze point in 0 to 1 screen coordinates
+  */
+  static GVec2 GetPredictedGazePoint(const float latency);
+
+  /*!
+  * Estimates how fast the gaze point is currently moving
+  * @return The velocity in screen units per second
+  */
+  static GVec2 GetGazeVelocity();
+
+  /*!
+  * Gets the per eye gaze from the latest sample, devices without per eye tracking report the same point for both eyes
+  * @return The gaze points in 0 to 1 screen coordinates, with their confidences
+  */
+  static BinocularGaze GetBinocularGaze();
+
+  static void SetPrediction(const GAZE_PREDICTION prediction);
+
+  static GAZE_PREDICTION GetPrediction();
+
   static int GetDeviceCount();
 
   static std::string GetDeviceName(const int index);
@@ -42,4 +103,21 @@ public:
 private:
   static std::vector<GazePointDevice> m_Devices;
   static int m_DeviceIndex;
+
+  //Ring buffer of the most recent samples
+  static std::vector<GazeSample> m_Samples;
+  static int m_SampleHead;
+  static int m_SampleCount;
+  static BinocularGaze m_Binocular;
+  static bool m_Paused;
+
+  static GAZE_PREDICTION m_Prediction;
+
+  //Sums up powers of time (relative to the latest sample) and the sample positions weighted by them, for least squares fits
+  //The latest minSamples samples are always used, even if they are older than the window
+  //Returns the number of samples used
+  static int SumSamples(const double window, const int minSamples, double st[5], double sx[3], double sy[3]);
+
+  //Reads the current device, combining both eyes weighted by their confidence
+  static GVec2 ReadGazePoint();
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "GazeTrace.h"
+#include "../../../Log.h"
+#include "../../../Config.h"
+#include <SDL_events.h>
+#include <cstring>
+#include <algorithm>
+#include <gtc/quaternion.hpp>
+
+std::ofstream GazeTrace::m_RecordFile;
+std::ifstream GazeTrace::m_ReplayFile;
+GazeTraceFrame GazeTrace::m_Frame = {};
+double GazeTrace::m_StartTime = -1.0;
+u32 GazeTrace::m_FrameIndex = 0;
+bool GazeTrace::m_ReplayCamera = true;
+bool GazeTrace::m_ReplayLoop = false;
+bool GazeTrace::m_Paused = false;
+double GazeTrace::m_TimeOffset = 0.0;
+double GazeTrace::m_LastReplayTime = 0.0;
+
+const char TRACE_MAGIC[4] = {'G', 'Z', 'T', 'R'};
+const u32 TRACE_VERSION = 1;
+const std::streamoff TRACE_HEADER_SIZE = sizeof(TRACE_MAGIC) + sizeof(TRACE_VERSION);
+
+void GazeTrace::Init() {
+  if (Config::OptionExists("GazeReplayFile")) {
+    const std::string file = Config::GetOptionString("GazeReplayFile");
+    m_ReplayFile.open(file, std::ios::binary);
+
+    char magic[4] = {};
+    u32 version = 0;
+    m_ReplayFile.read(magic, sizeof(magic));
+    m_ReplayFile.read((char*)&version, sizeof(version));
+    if (!m_ReplayFile || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || version != TRACE_VERSION) {
+      Log::LogWarning("Could not read gaze trace " + file);
+      m_ReplayFile.close();
+    } else {
+      Log::LogInfo("Replaying gaze trace " + file);
+    }
+
+    m_ReplayCamera = !Config::OptionExists("GazeReplayCamera") || Config::GetOptionInt("GazeReplayCamera") == 1;
+    m_ReplayLoop = Config::OptionExists("GazeReplayLoop") && Config::GetOptionInt("GazeReplayLoop") == 1;
+  } else if (Config::OptionExists("GazeRecordFile")) {
+    const std::string file = Config::GetOptionString("GazeRecordFile");
+    m_RecordFile.open(file, std::ios::binary | std::ios::trunc);
+
+    if (!m_RecordFile) {
+      Log::LogWarning("Could not create gaze trace " + file);
+    } else {
+      m_RecordFile.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+      m_RecordFile.write((const char*)&TRACE_VERSION, sizeof(TRACE_VERSION));
+      Log::LogInfo("Recording gaze trace to " + file);
+    }
+  }
+}
+
+void GazeTrace::Shutdown() {
+  if (m_RecordFile.is_open()) {
+    m_RecordFile.close();
+  }
+  if (m_ReplayFile.is_open()) {
+    m_ReplayFile.close();
+  }
+}
+
+bool GazeTrace::IsRecording() {
+  return m_RecordFile.is_open();
+}
+
+bool GazeTrace::IsReplaying() {
+  return m_ReplayFile.is_open();
+}
+
+void GazeTrace::BeginFrame(Mat4 &view) {
+  //A paused replay shows the frame it was on again
+  const bool holdFrame = IsReplaying() && m_Paused;
+  if (!holdFrame) {
+    m_FrameIndex++;
+  }
+
+  if (IsReplaying()) {
+    if (!holdFrame && !m_ReplayFile.read((char*)&m_Frame, sizeof(GazeTraceFrame)) && m_ReplayLoop) {
+      Rewind();
+      m_ReplayFile.read((char*)&m_Frame, sizeof(GazeTraceFrame));
+    }
+    if (!m_ReplayFile) {
+      Log::LogInfo("Gaze trace finished after " + std::to_string(m_FrameIndex - 1) + " frames");
+      m_ReplayFile.close();
+
+      //Traces are for benchmark runs, so end the run with the trace
+      SDL_Event quit = {};
+      quit.type = SDL_QUIT;
+      SDL_PushEvent(&quit);
+      return;
+    }
+
+    if (!m_ReplayCamera) {
+      return;
+    }
+    glm::quat rotation = glm::quat(m_Frame.cameraRotation[3], m_Frame.cameraRotation[0], m_Frame.cameraRotation[1], m_Frame.cameraRotation[2]);
+    Mat4 cameraTransform = glm::mat4_cast(rotation);
+    cameraTransform[3] = Vec4(m_Frame.cameraPosition[0], m_Frame.cameraPosition[1], m_Frame.cameraPosition[2], 1.0f);
+    view = glm::inverse(cameraTransform);
+  } else if (IsRecording()) {
+    //Store the camera as a position and rotation, the view matrix never has any scale
+    Mat4 cameraTransform = glm::inverse(view);
+    glm::quat rotation = glm::quat_cast(glm::mat3(cameraTransform));
+    m_Frame.cameraPosition[0] = cameraTransform[3].x;
+    m_Frame.cameraPosition[1] = cameraTransform[3].y;
+    m_Frame.cameraPosition[2] = cameraTransform[3].z;
+    m_Frame.cameraRotation[0] = rotation.x;
+    m_Frame.cameraRotation[1] = rotation.y;
+    m_Frame.cameraRotation[2] = rotation.z;
+    m_Frame.cameraRotation[3] = rotation.w;
+  }
+}
+
+void GazeTrace::Rewind() {
+  if (IsReplaying()) {
+    m_ReplayFile.clear();
+    m_ReplayFile.seekg(TRACE_HEADER_SIZE);
+
+    //Leave a frame's worth of time between the end of the trace and its start
+    const double frameTime = m_FrameIndex > 1 ? m_LastReplayTime / (m_FrameIndex - 1) : 0.0;
+    m_TimeOffset = m_LastReplayTime + std::max(frameTime, 0.001);
+  }
+}
+
+void GazeTrace::SetPaused(const bool paused) {
+  m_Paused = paused;
+}
+
+GazeSample GazeTrace::GetReplayedSample(BinocularGaze &eyes) {
+  eyes = m_Frame.eyes;
+
+  GazeSample sample;
+  sample.point = m_Frame.point;
+  sample.time = m_Frame.time + m_TimeOffset;
+  m_LastReplayTime = sample.time;
+  return sample;
+}
+
+void GazeTrace::RecordSample(const GazeSample &sample, const BinocularGaze &eyes) {
+  if (m_StartTime < 0.0) {
+    m_StartTime = sample.time;
+  }
+
+  m_Frame.time = sample.time - m_StartTime;
+  m_Frame.point = sample.point;
+  m_Frame.eyes = eyes;
+  m_RecordFile.write((const char*)&m_Frame, sizeof(GazeTraceFrame));
+}
+
+u32 GazeTrace::GetFrameIndex() {
+  return m_FrameIndex;
+}
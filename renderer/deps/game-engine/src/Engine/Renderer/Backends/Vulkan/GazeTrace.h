@@ -0,0 +1,82 @@
+#pragma once
+
+#include "GazePoint.h"
+#include "../../../CommonTypes.h"
+#include <fstream>
+
+//One frame of a gaze trace, written to the file as is
+struct GazeTraceFrame {
+  double time;
+  GVec2 point;
+  BinocularGaze eyes;
+  float cameraPosition[3];
+  float cameraRotation[4];
+};
+
+/**
+* Records the gaze samples and camera poses of each frame to a binary file, or plays a recording back one frame at a time
+* Replaying drives both the gaze point and the camera, so different builds can be compared on the same eye movements
+* The file is a "GZTR" header and version followed by one GazeTraceFrame per frame
+*/
+class GazeTrace {
+public:
+  /*!
+  * Starts recording to GazeRecordFile or replaying GazeReplayFile, if either is set in the config
+  * GazeReplayCamera=0 replays only the gaze, GazeReplayLoop=1 starts the trace over instead of quitting at its end
+  */
+  static void Init();
+
+  static void Shutdown();
+
+  static bool IsRecording();
+
+  static bool IsReplaying();
+
+  /*!
+  * Starts a new frame, should be called once per frame before the camera is used
+  * When replaying this reads the next frame, and quits the application once the trace runs out
+  * @param[in,out] view The camera view matrix, replaced by the recorded one when replaying
+  */
+  static void BeginFrame(Mat4 &view);
+
+  /*!
+  * Starts the replay over from its first frame
+  */
+  static void Rewind();
+
+  /*!
+  * Holds the replay on its current frame, so the gaze and camera repeat until it is unpaused
+  * @param[in] paused Whether to hold the current frame
+  */
+  static void SetPaused(const bool paused);
+
+  /*!
+  * Gets the gaze of the frame being replayed
+  * @param[out] eyes The per eye gaze of the frame
+  * @return The gaze sample, timed relative to the start of the trace
+  */
+  static GazeSample GetReplayedSample(BinocularGaze &eyes);
+
+  /*!
+  * Writes the current frame with its gaze and the camera passed to BeginFrame
+  * @param[in] sample The gaze sample used for this frame
+  * @param[in] eyes The per eye gaze used for this frame
+  */
+  static void RecordSample(const GazeSample &sample, const BinocularGaze &eyes);
+
+  static u32 GetFrameIndex();
+
+private:
+  static std::ofstream m_RecordFile;
+  static std::ifstream m_ReplayFile;
+  static GazeTraceFrame m_Frame;
+  static double m_StartTime;
+  static u32 m_FrameIndex;
+  static bool m_ReplayCamera;
+  static bool m_ReplayLoop;
+  static bool m_Paused;
+
+  //Keeps replayed sample times increasing when the trace starts over
+  static double m_TimeOffset;
+  static double m_LastReplayTime;
+};
@@ -49,3 +49,11 @@ VkDescriptorBufferInfo VKBuffer::GetBufferInfo() {
 
   return ret;
 }
+VkDescriptorBufferInfo VKBuffer::GetBufferInfo(const VkDeviceSize offset, const VkDeviceSize range) {
+  VkDescriptorBufferInfo ret = {};
+  ret.buffer = m_Buffer;
+  ret.offset = offset;
+  ret.range = range;
+
+  return ret;
+}
@@ -12,6 +12,7 @@ public:
   void* Map(VmaAllocator allocator);
   void UnMap(VmaAllocator allocator);
   VkDescriptorBufferInfo GetBufferInfo();
+  VkDescriptorBufferInfo GetBufferInfo(const VkDeviceSize offset, const VkDeviceSize range);
 private:
   VkBuffer m_Buffer;
   VmaAllocation m_Allocation;
@@ -7,17 +7,22 @@ const u32 INVALID_QUEUE_INDEX = 0xffffffff;
 
 const float QUEUE_PRIORITY = 1.0f;
 
-const u32 MAX_ALLOCATED_UBOS = 16;
-const u32 MAX_ALLOCATED_IMAGES = 2048;
-const u32 MAX_ALLOCATED_SETS = 2048;
+const u32 MAX_ALLOCATED_UBOS = 256;
+//Every texture takes two sets and two image descriptors, one for the full sampler and one for the periphery sampler
+const u32 MAX_ALLOCATED_IMAGES = 4096;
+const u32 MAX_ALLOCATED_SETS = 4096;
 
 VKDevice::VKDevice() {
   m_PhysDevice = VK_NULL_HANDLE;
   m_Device = VK_NULL_HANDLE;
   m_GraphicsQueueFamily = INVALID_QUEUE_INDEX;
   m_PresentQueueFamily = INVALID_QUEUE_INDEX;
+  m_TransferQueueFamily = INVALID_QUEUE_INDEX;
+  m_GraphicsTimestampBits = 0;
+  m_SamplerAnisotropy = false;
   m_GraphicsQueue = VK_NULL_HANDLE;
   m_PresentQueue = VK_NULL_HANDLE;
+  m_TransferQueue = VK_NULL_HANDLE;
   m_CommandPool = VK_NULL_HANDLE;
   m_DescriptorPool = VK_NULL_HANDLE;
   m_PhysDeviceProperties = {};
@@ -53,10 +58,10 @@ void VKDevice::SetupDevice(VkInstance instance, const std::vector<const char *>
   Log::LogInfo("[VKBackend] " + std::to_string(m_PhysDeviceProperties.limits.maxMemoryAllocationCount) + " Memory Allocations are possible");
   Log::LogInfo("[VKBackend] " + std::to_string(m_PhysDeviceProperties.limits.maxPushConstantsSize) + " bytes is the max push constant size");
 
-  //Check for required push constant size
-  if (m_PhysDeviceProperties.limits.maxPushConstantsSize < sizeof(Mat4)) {
+  //Check for required push constant size, a model matrix plus the layer blending info
+  if (m_PhysDeviceProperties.limits.maxPushConstantsSize < sizeof(Mat4) + sizeof(Vec4)) {
     Log::LogFatal("[VKBackend] Device Push constant size is not high enough");
-    Log::LogFatal("[VKBackend] " + std::to_string(sizeof(Mat4)) + " bytes are necessary");
+    Log::LogFatal("[VKBackend] " + std::to_string(sizeof(Mat4) + sizeof(Vec4)) + " bytes are necessary");
     exit(1);
   }
 
@@ -85,8 +90,11 @@ void VKDevice::SetupDevice(VkInstance instance, const std::vector<const char *>
     }
   }
 
-  //Get usable present queue family
-  for (u32 i = 0; i < queueFamilies.size(); i++) {
+  //Get usable present queue family, without a surface nothing is presented so the graphics queue stands in
+  if (surface == VK_NULL_HANDLE) {
+    m_PresentQueueFamily = m_GraphicsQueueFamily;
+  }
+  for (u32 i = 0; i < queueFamilies.size() && surface != VK_NULL_HANDLE; i++) {
     VkBool32 presentSupport;
     vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysDevice, i, surface, &presentSupport);
 
@@ -97,11 +105,25 @@ void VKDevice::SetupDevice(VkInstance instance, const std::vector<const char *>
 
   if (m_GraphicsQueueFamily == INVALID_QUEUE_INDEX || m_PresentQueueFamily == INVALID_QUEUE_INDEX) {
     Log::LogFatal("[VKBackend] No present/graphics queue available");
+  } else {
+    m_GraphicsTimestampBits = queueFamilies[m_GraphicsQueueFamily].timestampValidBits;
+  }
+
+  //Prefer a transfer only family for uploads, those usually map to the copy engines and run alongside rendering
+  m_TransferQueueFamily = m_GraphicsQueueFamily;
+  for (u32 i = 0; i < queueFamilies.size(); i++) {
+    const VkQueueFlags flags = queueFamilies[i].queueFlags;
+    if (queueFamilies[i].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      m_TransferQueueFamily = i;
+      Log::LogInfo("[VKBackend] Using dedicated transfer queue family " + std::to_string(i));
+      break;
+    }
   }
 
   std::set<u32> uniqueQueueFamilies;
   uniqueQueueFamilies.insert(m_PresentQueueFamily);
   uniqueQueueFamilies.insert(m_GraphicsQueueFamily);
+  uniqueQueueFamilies.insert(m_TransferQueueFamily);
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
@@ -113,8 +135,15 @@ void VKDevice::SetupDevice(VkInstance instance, const std::vector<const char *>
     queueCreateInfos.push_back(queueCreateInfo);
   }
   //Create logical device
+  //Anisotropic filtering is the only optional feature used
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(m_PhysDevice, &supportedFeatures);
+  VkPhysicalDeviceFeatures enabledFeatures = {};
+  enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+  m_SamplerAnisotropy = supportedFeatures.samplerAnisotropy == VK_TRUE;
+
   VkDeviceCreateInfo deviceCreateInfo = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
-  deviceCreateInfo.pEnabledFeatures = nullptr;
+  deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
   deviceCreateInfo.enabledExtensionCount = (u32)requiredExtensions.size();
   deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
   deviceCreateInfo.queueCreateInfoCount = (u32)queueCreateInfos.size();
@@ -124,6 +153,7 @@ void VKDevice::SetupDevice(VkInstance instance, const std::vector<const char *>
   //Get queue handles
   vkGetDeviceQueue(m_Device, m_GraphicsQueueFamily, 0, &m_GraphicsQueue);
   vkGetDeviceQueue(m_Device, m_PresentQueueFamily, 0, &m_PresentQueue);
+  vkGetDeviceQueue(m_Device, m_TransferQueueFamily, 0, &m_TransferQueue);
 
   //Create command pool
   VkCommandPoolCreateInfo poolCreateInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
@@ -166,12 +196,27 @@ VkQueue VKDevice::GetGraphicsQueue() {
 VkQueue VKDevice::GetPresentQueue() {
   return m_PresentQueue;
 }
+VkQueue VKDevice::GetTransferQueue() {
+  return m_TransferQueue;
+}
+u32 VKDevice::GetGraphicsQueueFamily() {
+  return m_GraphicsQueueFamily;
+}
+u32 VKDevice::GetTransferQueueFamily() {
+  return m_TransferQueueFamily;
+}
 VkCommandPool VKDevice::GetCommandPool() {
   return m_CommandPool;
 }
 VkPhysicalDeviceProperties VKDevice::GetDeviceProperties() {
   return m_PhysDeviceProperties;
 }
+u32 VKDevice::GetGraphicsTimestampBits() {
+  return m_GraphicsTimestampBits;
+}
+bool VKDevice::SupportsSamplerAnisotropy() {
+  return m_SamplerAnisotropy;
+}
 VkDescriptorPool VKDevice::GetDescriptorPool() {
   return m_DescriptorPool;
 }
@@ -11,9 +11,15 @@ public:
   VkDevice GetDevice();
   VkQueue GetGraphicsQueue();
   VkQueue GetPresentQueue();
+  //Same as the graphics queue when the device has no transfer only family
+  VkQueue GetTransferQueue();
+  u32 GetGraphicsQueueFamily();
+  u32 GetTransferQueueFamily();
   VkCommandPool GetCommandPool();
   VkDescriptorPool GetDescriptorPool();
   VkPhysicalDeviceProperties GetDeviceProperties();
+  u32 GetGraphicsTimestampBits();
+  bool SupportsSamplerAnisotropy();
   std::vector<VkCommandBuffer> AllocateCommandBuffers(VkCommandBufferLevel level, u32 count);
   void FreeCommandBuffers(std::vector<VkCommandBuffer> buffers);
 private:
@@ -22,8 +28,12 @@ private:
   VkPhysicalDeviceProperties m_PhysDeviceProperties;
   u32 m_GraphicsQueueFamily;
   u32 m_PresentQueueFamily;
+  u32 m_TransferQueueFamily;
+  u32 m_GraphicsTimestampBits;
+  bool m_SamplerAnisotropy;
   VkQueue m_GraphicsQueue;
   VkQueue m_PresentQueue;
+  VkQueue m_TransferQueue;
   VkCommandPool m_CommandPool;
   VkDescriptorPool m_DescriptorPool;
 };
@@ -14,7 +14,8 @@ void VKFrameBuffer::Setup(const u32 width,
                           VkFormat depthFormat,
                           const bool depthStoreRequired,
                           VkDevice device,
-                          VmaAllocator allocator) {
+                          VmaAllocator allocator,
+                          const VkImageUsageFlags extraColorUsage) {
   //Create images for framebuffer and setup attachment descriptions
   hasDepth = depthFormat != VK_FORMAT_UNDEFINED;
   std::vector<VkImageView> imageViews(colorFormats.size());
@@ -26,7 +27,7 @@ void VKFrameBuffer::Setup(const u32 width,
   m_Height = height;
 
   for (u32 i = 0; i < colorFormats.size(); i++) {
-    m_ColorAttachments[i].Setup(width, height, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, colorFormats[i], VK_IMAGE_ASPECT_COLOR_BIT, device, allocator);
+    m_ColorAttachments[i].Setup(width, height, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | extraColorUsage, colorFormats[i], VK_IMAGE_ASPECT_COLOR_BIT, device, allocator);
     attachDescriptions[i].format = colorFormats[i];
     attachDescriptions[i].samples = VK_SAMPLE_COUNT_1_BIT;
     attachDescriptions[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
@@ -77,11 +78,29 @@ void VKFrameBuffer::Setup(const u32 width,
     subpass.pDepthStencilAttachment = nullptr;
   }
 
+  //The framebuffer is shared by every frame in flight, so order writes against the previous frame's sampling and the next pass's reads
+  VkSubpassDependency dependencies[2] = {};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
   VkRenderPassCreateInfo createInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
   createInfo.attachmentCount = static_cast<u32>(attachDescriptions.size());
   createInfo.pAttachments = attachDescriptions.data();
   createInfo.subpassCount = 1;
   createInfo.pSubpasses = &subpass;
+  createInfo.dependencyCount = 2;
+  createInfo.pDependencies = dependencies;
 
   VKError::CheckResult(vkCreateRenderPass(device, &createInfo, nullptr, &m_RenderPass), "Could not make renderpass");
 
@@ -109,6 +128,9 @@ std::vector<VkImageView> VKFrameBuffer::GetColorImageViews() {
 
   return ret;
 }
+VkImage VKFrameBuffer::GetColorImage(const u32 index) {
+  return m_ColorAttachments[index].GetImage();
+}
 void VKFrameBuffer::Destroy(VkDevice device, VmaAllocator allocator) {
   vkDestroySemaphore(device, m_RenderPassFinishedSemaphore, nullptr);
   vkDestroyFramebuffer(device, m_Framebuffer, nullptr);
@@ -6,7 +6,7 @@
 class VKFrameBuffer {
 public:
   VKFrameBuffer();
-  void Setup(const u32 width, const u32 height, const std::vector<VkFormat> &colorFormats, VkFormat depthFormat, const bool depthStoreRequired, VkDevice device, VmaAllocator allocator);
+  void Setup(const u32 width, const u32 height, const std::vector<VkFormat> &colorFormats, VkFormat depthFormat, const bool depthStoreRequired, VkDevice device, VmaAllocator allocator, const VkImageUsageFlags extraColorUsage = 0);
   void Destroy(VkDevice device, VmaAllocator allocator);
   u32 GetWidth();
   u32 GetHeight();
@@ -14,6 +14,7 @@ public:
   VkRenderPass GetRenderPass();
   VkSemaphore GetSemaphore();
   std::vector<VkImageView> GetColorImageViews();
+  VkImage GetColorImage(const u32 index);
   VkImageView GetDepthImageView();
   std::vector<VkDescriptorImageInfo> GetColorImageInfos(VkSampler sampler);
   VkDescriptorImageInfo GetDepthImageInfo(VkSampler sampler);
@@ -0,0 +1,121 @@
+#include "VKGeometryArena.h"
+#include "../../Model.h"
+
+VKGeometryArena::VKGeometryArena() {
+  m_Device = nullptr;
+  m_Allocator = VK_NULL_HANDLE;
+  m_VertexBuffer = VK_NULL_HANDLE;
+  m_VertexAllocation = VK_NULL_HANDLE;
+  m_IndexBuffer = VK_NULL_HANDLE;
+  m_IndexAllocation = VK_NULL_HANDLE;
+}
+
+void VKGeometryArena::Setup(VKDevice* device, VmaAllocator allocator, const u32 vertexCount, const u32 indexCount) {
+  m_Device = device;
+  m_Allocator = allocator;
+
+  m_VertexBuffer = CreateBuffer((VkDeviceSize)vertexCount * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_VertexAllocation);
+  m_IndexBuffer = CreateBuffer((VkDeviceSize)indexCount * sizeof(u32), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_IndexAllocation);
+
+  m_FreeVertices.Reset(vertexCount);
+  m_FreeIndices.Reset(indexCount);
+}
+
+void VKGeometryArena::Destroy() {
+  vmaDestroyBuffer(m_Allocator, m_VertexBuffer, m_VertexAllocation);
+  vmaDestroyBuffer(m_Allocator, m_IndexBuffer, m_IndexAllocation);
+}
+
+bool VKGeometryArena::Allocate(const u32 vertexCount, const u32 indexCount, u32 &firstVertex, u32 &firstIndex) {
+  if (!m_FreeVertices.Allocate(vertexCount, firstVertex)) {
+    return false;
+  }
+  if (!m_FreeIndices.Allocate(indexCount, firstIndex)) {
+    m_FreeVertices.Free(firstVertex, vertexCount);
+    return false;
+  }
+  return true;
+}
+
+void VKGeometryArena::Free(const u32 firstVertex, const u32 vertexCount, const u32 firstIndex, const u32 indexCount) {
+  m_FreeVertices.Free(firstVertex, vertexCount);
+  m_FreeIndices.Free(firstIndex, indexCount);
+}
+
+VkBuffer VKGeometryArena::GetVertexBuffer() {
+  return m_VertexBuffer;
+}
+
+VkBuffer VKGeometryArena::GetIndexBuffer() {
+  return m_IndexBuffer;
+}
+
+VkBuffer VKGeometryArena::CreateBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VmaAllocation &allocation) {
+  const u32 queueFamilies[] = { m_Device->GetGraphicsQueueFamily(), m_Device->GetTransferQueueFamily() };
+
+  VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bufferInfo.size = size;
+  bufferInfo.usage = usage;
+  //Uploads write new meshes while the graphics queue draws the others, so neither queue can own the whole buffer
+  if (queueFamilies[0] != queueFamilies[1]) {
+    bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufferInfo.queueFamilyIndexCount = 2;
+    bufferInfo.pQueueFamilyIndices = queueFamilies;
+  } else {
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  }
+
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  VkBuffer buffer;
+  vmaCreateBuffer(m_Allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+  return buffer;
+}
+
+void VKGeometryArena::FreeList::Reset(const u32 size) {
+  m_Ranges.clear();
+  m_Ranges[0] = size;
+}
+
+bool VKGeometryArena::FreeList::Allocate(const u32 size, u32 &offset) {
+  if (size == 0) {
+    offset = 0;
+    return true;
+  }
+
+  for (auto it = m_Ranges.begin(); it != m_Ranges.end(); ++it) {
+    if (it->second >= size) {
+      offset = it->first;
+      const u32 remaining = it->second - size;
+      m_Ranges.erase(it);
+      if (remaining > 0) {
+        m_Ranges[offset + size] = remaining;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void VKGeometryArena::FreeList::Free(const u32 offset, const u32 size) {
+  if (size == 0) {
+    return;
+  }
+
+  auto it = m_Ranges.emplace(offset, size).first;
+
+  //Merge with the range after, then the range before
+  auto next = std::next(it);
+  if (next != m_Ranges.end() && it->first + it->second == next->first) {
+    it->second += next->second;
+    m_Ranges.erase(next);
+  }
+  if (it != m_Ranges.begin()) {
+    auto prev = std::prev(it);
+    if (prev->first + prev->second == it->first) {
+      prev->second += it->second;
+      m_Ranges.erase(it);
+    }
+  }
+}
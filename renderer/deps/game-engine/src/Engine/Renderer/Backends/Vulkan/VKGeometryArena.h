@@ -0,0 +1,67 @@
+#pragma once
+
+#include "VKDevice.h"
+#include <vk_mem_alloc.h>
+#include <map>
+
+/**
+* One vertex buffer and one index buffer that meshes are sub-allocated from, so a pass can bind geometry once
+* Space is counted in vertices and indices, which makes allocations usable directly as vertexOffset and firstIndex
+* Freed ranges are merged with their neighbours so the free list stays short and large meshes still fit
+*/
+class VKGeometryArena {
+public:
+  VKGeometryArena();
+
+  /*!
+  * Creates both buffers, shared between the graphics and transfer queue families so uploads need no ownership transfers
+  * @param[in] device The device to allocate on
+  * @param[in] allocator The allocator to use
+  * @param[in] vertexCount How many vertices the arena holds
+  * @param[in] indexCount How many indices the arena holds
+  */
+  void Setup(VKDevice* device, VmaAllocator allocator, const u32 vertexCount, const u32 indexCount);
+  void Destroy();
+
+  /*!
+  * Reserves room for a mesh
+  * @param[in] vertexCount The mesh's vertex count
+  * @param[in] indexCount The mesh's index count, including every detail level
+  * @param[out] firstVertex Where the mesh's vertices start
+  * @param[out] firstIndex Where the mesh's indices start
+  * @return False if either buffer has no free range big enough
+  */
+  bool Allocate(const u32 vertexCount, const u32 indexCount, u32 &firstVertex, u32 &firstIndex);
+
+  /*!
+  * Returns a mesh's room to the arena, the GPU must be done with it
+  */
+  void Free(const u32 firstVertex, const u32 vertexCount, const u32 firstIndex, const u32 indexCount);
+
+  VkBuffer GetVertexBuffer();
+  VkBuffer GetIndexBuffer();
+
+private:
+  //Free ranges keyed by offset, first fit keeps meshes packed towards the start
+  class FreeList {
+  public:
+    void Reset(const u32 size);
+    bool Allocate(const u32 size, u32 &offset);
+    void Free(const u32 offset, const u32 size);
+  private:
+    std::map<u32, u32> m_Ranges;
+  };
+
+  VkBuffer CreateBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VmaAllocation &allocation);
+
+  VKDevice* m_Device;
+  VmaAllocator m_Allocator;
+
+  VkBuffer m_VertexBuffer;
+  VmaAllocation m_VertexAllocation;
+  VkBuffer m_IndexBuffer;
+  VmaAllocation m_IndexAllocation;
+
+  FreeList m_FreeVertices;
+  FreeList m_FreeIndices;
+};
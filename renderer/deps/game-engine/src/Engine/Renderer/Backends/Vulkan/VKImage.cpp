@@ -2,6 +2,7 @@
 VKImage::VKImage() {
   m_Image = VK_NULL_HANDLE;
   m_ImageView = VK_NULL_HANDLE;
+  m_MipLevels = 1;
 }
 void VKImage::Setup(const u32 width,
                     const u32 height,
@@ -9,14 +10,17 @@ void VKImage::Setup(const u32 width,
                     VkFormat format,
                     VkImageAspectFlagBits imageAspect,
                     VkDevice device,
-                    VmaAllocator allocator) {
+                    VmaAllocator allocator,
+                    const u32 mipLevels) {
+  m_MipLevels = mipLevels;
+
   //Create image handle and allocate memory
   VkImageCreateInfo imageCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
   imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
   imageCreateInfo.extent.width = width;
   imageCreateInfo.extent.height = height;
   imageCreateInfo.extent.depth = 1;
-  imageCreateInfo.mipLevels = 1;
+  imageCreateInfo.mipLevels = mipLevels;
   imageCreateInfo.arrayLayers = 1;
   imageCreateInfo.format = format;
   imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -36,7 +40,7 @@ void VKImage::Setup(const u32 width,
   imageViewCreateInfo.format = format;
   imageViewCreateInfo.subresourceRange.aspectMask = imageAspect;
   imageViewCreateInfo.subresourceRange.layerCount = 1;
-  imageViewCreateInfo.subresourceRange.levelCount = 1;
+  imageViewCreateInfo.subresourceRange.levelCount = mipLevels;
   imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
   imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
   vkCreateImageView(device, &imageViewCreateInfo, nullptr, &m_ImageView);
@@ -47,6 +51,9 @@ VkImage VKImage::GetImage() {
 VkImageView VKImage::GetImageView() {
   return m_ImageView;
 }
+u32 VKImage::GetMipLevels() {
+  return m_MipLevels;
+}
 void VKImage::Destroy(VkDevice device, VmaAllocator allocator) {
   vkDestroyImageView(device, m_ImageView, nullptr);
   vmaDestroyImage(allocator, m_Image, m_Memory);
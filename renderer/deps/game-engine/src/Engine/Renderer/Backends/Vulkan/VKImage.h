@@ -6,12 +6,14 @@
 class VKImage {
 public:
   VKImage();
-  void Setup(const u32 width, const u32 height, VkImageUsageFlags usage, VkFormat format, VkImageAspectFlagBits imageAspect, VkDevice device, VmaAllocator allocator);
+  void Setup(const u32 width, const u32 height, VkImageUsageFlags usage, VkFormat format, VkImageAspectFlagBits imageAspect, VkDevice device, VmaAllocator allocator, const u32 mipLevels = 1);
   void Destroy(VkDevice device, VmaAllocator allocator);
   VkImage GetImage();
   VkImageView GetImageView();
+  u32 GetMipLevels();
 private:
   VkImage m_Image;
   VkImageView m_ImageView;
   VmaAllocation m_Memory;
+  u32 m_MipLevels;
 };
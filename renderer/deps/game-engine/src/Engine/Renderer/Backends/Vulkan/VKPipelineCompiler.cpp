@@ -0,0 +1,58 @@
+#include "VKPipelineCompiler.h"
+#include <algorithm>
+
+void VKPipelineCompiler::Start(const u32 threadCount) {
+  m_Stopping = false;
+  for (u32 i = 0; i < std::max(1u, threadCount); i++) {
+    m_Workers.emplace_back(&VKPipelineCompiler::WorkerLoop, this);
+  }
+}
+
+void VKPipelineCompiler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stopping = true;
+  }
+  m_JobAvailable.notify_all();
+  for (auto &worker : m_Workers) {
+    worker.join();
+  }
+  m_Workers.clear();
+}
+
+void VKPipelineCompiler::Submit(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Jobs.push_back(std::move(job));
+  }
+  m_JobAvailable.notify_one();
+}
+
+void VKPipelineCompiler::WaitIdle() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_JobsFinished.wait(lock, [this] { return m_Jobs.empty() && m_RunningJobs == 0; });
+}
+
+void VKPipelineCompiler::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while (true) {
+    m_JobAvailable.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+    //Stopping still drains the queue so no shader is left half made
+    if (m_Jobs.empty()) {
+      return;
+    }
+
+    std::function<void()> job = std::move(m_Jobs.front());
+    m_Jobs.pop_front();
+    m_RunningJobs++;
+
+    lock.unlock();
+    job();
+    lock.lock();
+
+    m_RunningJobs--;
+    if (m_Jobs.empty() && m_RunningJobs == 0) {
+      m_JobsFinished.notify_all();
+    }
+  }
+}
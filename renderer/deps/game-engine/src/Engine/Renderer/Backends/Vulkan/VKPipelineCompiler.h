@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../../../CommonTypes.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* Small pool of worker threads that builds pipelines off the render thread
+* Jobs run in the order they were submitted, across however many workers are free
+*/
+class VKPipelineCompiler {
+public:
+  /*!
+  * Starts the worker threads
+  * @param[in] threadCount How many workers to run, at least one is always started
+  */
+  void Start(const u32 threadCount);
+
+  /*!
+  * Finishes every queued job and then joins the workers
+  */
+  void Stop();
+
+  /*!
+  * Queues a job for the next free worker
+  * @param[in] job The work to run, it must only touch thread safe Vulkan objects
+  */
+  void Submit(std::function<void()> job);
+
+  /*!
+  * Blocks until every queued and running job has finished
+  */
+  void WaitIdle();
+
+private:
+  void WorkerLoop();
+
+  std::vector<std::thread> m_Workers;
+  std::deque<std::function<void()>> m_Jobs;
+  std::mutex m_Mutex;
+  std::condition_variable m_JobAvailable;
+  std::condition_variable m_JobsFinished;
+  u32 m_RunningJobs = 0;
+  bool m_Stopping = false;
+};
@@ -2,6 +2,8 @@
 #include "VKRenderer.h"
 #include "../../../Log.h"
 #include <SDL_video.h>
+#include <SDL_timer.h>
+#include <SDL_filesystem.h>
 #include "VKVertexBuffer.h"
 #include "VKTexture.h"
 #include "VKFrameBuffer.h"
@@ -11,8 +13,13 @@
 #include "../../Frontend.h"
 #include "../../../Config.h"
 #include "GazePoint.h"
+#include "GazeTrace.h"
+#include "../../Frustum.h"
 
 #include <gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
 
 u8 dummyImageData[] = {
   0x00, 0x00, 0x00, 0xff,
@@ -25,7 +32,13 @@ u8 dummyImageData[] = {
 #include <gtx/euler_angles.hpp>
 #include <gtc/type_ptr.hpp>
 
-const int STAGING_BUFFER_SIZE = 64 * 1024 * 1024; //64MB should be plenty for a staging buffer
+//Vertices the geometry arena holds by default, meshes beyond that get buffers of their own
+const u32 GEOMETRY_ARENA_VERTICES = 2000000;
+
+//Largest arena GeometryArenaVertices can ask for, in millions, keeps the vertex and index counts well inside a u32
+const int MAX_GEOMETRY_ARENA_MILLIONS = 100;
+
+const int STAGING_BUFFER_SIZE = 64 * 1024 * 1024; //64MB ring shared by all uploads in flight, bigger assets get their own staging buffer
 
 const std::vector<const char*> VALIDATION_LAYERS = {
   "VK_LAYER_LUNARG_standard_validation"
@@ -43,6 +56,38 @@ const bool ENABLE_VALIDATION_LAYERS = true;
 
 const u32 SHADOW_SIZE = 4096;
 
+//Defaults for the gaze shadow cascade, the size of each cascade in texels and the extent of the gaze cascade in world units
+const u32 GAZE_SHADOW_SIZE = 1024;
+const float GAZE_SHADOW_RADIUS = 5.0f;
+const float GAZE_SHADOW_DISTANCE = 10.0f;
+
+const u32 MAX_FOVEATED_SIZE = 2400;
+const u32 MIN_FOVEATED_SIZE = 120;
+
+const int MAX_FOVEATION_LAYERS = 8;
+
+//Frames the CPU can record ahead of the GPU, ImGui keeps its own buffers for at most IMGUI_VK_QUEUED_FRAMES
+const u32 DEFAULT_FRAMES_IN_FLIGHT = 2;
+const u32 MAX_FRAMES_IN_FLIGHT = IMGUI_VK_QUEUED_FRAMES;
+
+//Pipeline cache file kept next to the executable, with a header so a cache from another GPU or driver is thrown away
+const std::string PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+const char PIPELINE_CACHE_MAGIC[4] = {'P', 'C', 'H', 'E'};
+struct PipelineCacheFileHeader {
+  char mMagic[4];
+  u32 mVendorID;
+  u32 mDeviceID;
+  u32 mDriverVersion;
+  u8 mPipelineCacheUUID[VK_UUID_SIZE];
+  u64 mDataSize;
+};
+
+//Pipelines rarely come in faster than a few workers can build them
+const u32 MAX_SHADER_COMPILE_THREADS = 4;
+
+//Eyes tracked with less confidence than this are left out of the binocular foveated region
+const float BINOCULAR_MIN_CONFIDENCE = 0.5f;
+
 bool VKBackend::IsUsable() {
   //Create a dummy SDL Vulkan window. 
   //If it works then we have vulkan support
@@ -59,13 +104,68 @@ void VKBackend::Init() {
   //Init foveated rendering devices
   GazePointManager::InitDevices();
   GazePointManager::SelectDevice(0); //TODO - replace this index with actual number
+  GazeTrace::Init();
+
+  //Gaze prediction: 0 = off, 1 = linear, 2 = constant acceleration
+  if (Config::OptionExists("GazePrediction")) {
+    int prediction = Config::GetOptionInt("GazePrediction");
+    if (prediction == 1) {
+      GazePointManager::SetPrediction(GAZE_PREDICTION::LINEAR);
+    } else if (prediction == 2) {
+      GazePointManager::SetPrediction(GAZE_PREDICTION::ACCELERATION);
+    }
+  }
+
+  //Time from the frame being submitted until it is lit on the display, beyond what the GPU timestamps measure
+  m_DisplayLatency = 0.0f;
+  if (Config::OptionExists("DisplayLatencyUs")) {
+    m_DisplayLatency = (float)Config::GetOptionInt("DisplayLatencyUs");
+  }
+  m_CPULatency = 0.0f;
+  m_CPUDrawTime = 0.0f;
+
+  //Saccadic suppression, speeds are in degrees per second
+  m_SaccadeSuppression = Config::OptionExists("SaccadeSuppression") && Config::GetOptionInt("SaccadeSuppression") == 1;
+  m_SaccadeOnsetSpeed = Config::OptionExists("SaccadeOnsetSpeed") ? (float)Config::GetOptionInt("SaccadeOnsetSpeed") : 180.0f;
+  m_SaccadeOffsetSpeed = Config::OptionExists("SaccadeOffsetSpeed") ? (float)Config::GetOptionInt("SaccadeOffsetSpeed") : 60.0f;
+  m_MaxSkippedFrames = Config::OptionExists("SaccadeMaxSkippedFrames") ? std::max(0, Config::GetOptionInt("SaccadeMaxSkippedFrames")) : 6;
+  m_InSaccade = false;
+  m_GazeSpeed = 0.0f;
+  m_SkippedFoveatedFrames = 0;
+  m_FoveatedHistoryValid = false;
+  m_LastFoveatedRect = {};
+  m_LastFoveatedCenter = Vec2(0.0f);
+
+  //Mesh level of detail, only used by models loaded with a detail chain
+  m_LODPixelError = Config::OptionExists("MeshLODPixelError") ? (float)Config::GetOptionInt("MeshLODPixelError") : 1.0f;
+  m_GazeDirection = Vec3(0.0f, 0.0f, -1.0f);
+  m_LastFoveatedRadius = 0.0f;
+
+  m_BinocularFoveation = Config::OptionExists("BinocularFoveation") && Config::GetOptionInt("BinocularFoveation") == 1;
+
+  m_EnableFoveatedRendering = true;
+  m_FoveationToggled = false;
+  m_BaseResScale = 1.0f;
+  m_CaptureBufferCreated = false;
+  m_CaptureRequested = false;
+  m_CaptureWritten = false;
+  m_CaptureGaze = Vec2(0.0f);
+  m_CaptureFrameIndex = 0;
+  m_ImageIndex = 0;
+  m_BoundGeometry = {};
+
+  //Gaze centered shadow cascade
+  m_GazeShadowCascade = Config::OptionExists("GazeShadowCascade") && Config::GetOptionInt("GazeShadowCascade") == 1;
+  m_GazeShadowRadius = Config::OptionExists("GazeShadowRadius") ? (float)std::max(1, Config::GetOptionInt("GazeShadowRadius")) : GAZE_SHADOW_RADIUS;
+  m_GazeShadowDistance = Config::OptionExists("GazeShadowDistance") ? (float)Config::GetOptionInt("GazeShadowDistance") : GAZE_SHADOW_DISTANCE;
 
 }
 
 void VKBackend::WindowInit(const std::string name, int width, const int height) {
-  //Create SDL window
+  //Create SDL window, headless mode renders offscreen for machines without a display
   const std::string windowName = name + "[Vulkan]";
-  m_Surface.CreateWindow(windowName, width, height);
+  const bool headless = Config::OptionExists("Headless") && Config::GetOptionInt("Headless") == 1;
+  m_Surface.CreateWindow(windowName, width, height, headless);
 
   //Log instance level extensions
   u32 instExtCount = 0;
@@ -113,9 +213,14 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   //Create window drawing surface
   m_Surface.CreateSurface(m_Instance);
 
-  m_Device.SetupDevice(m_Instance, REQUIRED_DEVICE_EXTENSIONS, m_Surface.GetSurface());
+  m_Device.SetupDevice(m_Instance, headless ? std::vector<const char*>() : REQUIRED_DEVICE_EXTENSIONS, m_Surface.GetSurface());
 
-  m_Surface.CreateSwapchain(m_Device.GetPhysicalDevice(), m_Device.GetDevice());
+  //The CPU records one frame while the GPU works through the ones before it, headless mode needs an offscreen image for each of them
+  m_FramesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+  if (Config::OptionExists("FramesInFlight")) {
+    m_FramesInFlight = (u32)std::max(1, std::min((int)MAX_FRAMES_IN_FLIGHT, Config::GetOptionInt("FramesInFlight")));
+  }
+  m_Surface.CreateSwapchain(m_Device.GetPhysicalDevice(), m_Device.GetDevice(), m_FramesInFlight);
   
   //Create memory allocator object
   VmaAllocatorCreateInfo allocatorInfo = {};
@@ -124,6 +229,16 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
 
   VKError::CheckResult(vmaCreateAllocator(&allocatorInfo, &m_MemAllocator), "Could not create memory allocator");
 
+  //Load the pipeline cache before anything creates pipelines
+  LoadPipelineCache();
+
+  //Workers for shaders created with CreateShaderAsync, leaving a core for the render thread
+  u32 compileThreads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+  if (Config::OptionExists("ShaderCompileThreads")) {
+    compileThreads = (u32)std::max(1, Config::GetOptionInt("ShaderCompileThreads"));
+  }
+  m_PipelineCompiler.Start(std::min(compileThreads, MAX_SHADER_COMPILE_THREADS));
+
   //Get supported swapchain properties
   VkSurfaceCapabilitiesKHR swapChainCapabilities = m_Surface.GetCapabilities();
 
@@ -132,13 +247,27 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   //World framebuffer
   std::vector<VkFormat> fbFormat(1);
   fbFormat[0] = m_Surface.GetDefaultFormat().format;
-  m_WorldFB.Setup(swapChainCapabilities.minImageExtent.width, swapChainCapabilities.minImageExtent.height, fbFormat, VK_FORMAT_D32_SFLOAT, false, m_Device.GetDevice(), m_MemAllocator);
+  //Reprojecting and upsampling the base pass need its depth to outlive the render pass
+  m_PeripheryUpdateRate = 1;
+  if (Config::OptionExists("PeripheryUpdateRate")) {
+    m_PeripheryUpdateRate = (u32)std::max(1, Config::GetOptionInt("PeripheryUpdateRate"));
+  }
+  const bool baseUpsample = Config::OptionExists("BaseUpsample") && Config::GetOptionInt("BaseUpsample") == 1;
+  const bool storeWorldDepth = m_PeripheryUpdateRate > 1 || baseUpsample;
+  m_WorldFB.Setup(swapChainCapabilities.minImageExtent.width, swapChainCapabilities.minImageExtent.height, fbFormat, VK_FORMAT_D32_SFLOAT, storeWorldDepth, m_Device.GetDevice(), m_MemAllocator);
+  m_WorldExtent = {m_WorldFB.GetWidth(), m_WorldFB.GetHeight()};
 
   //Foveated framebuffer
-  m_FoveatedFB.Setup(swapChainCapabilities.minImageExtent.width, swapChainCapabilities.minImageExtent.height, fbFormat, VK_FORMAT_D32_SFLOAT, false, m_Device.GetDevice(), m_MemAllocator);
+  m_FoveatedInset = Config::OptionExists("FoveatedInset") && Config::GetOptionInt("FoveatedInset") == 1;
+  if (m_FoveatedInset) {
+    //Only needs to hold the largest foveated square, which gets placed at the gaze point when composited
+    m_FoveatedFB.Setup(std::min(MAX_FOVEATED_SIZE, swapChainCapabilities.minImageExtent.width), std::min(MAX_FOVEATED_SIZE, swapChainCapabilities.minImageExtent.height), fbFormat, VK_FORMAT_D32_SFLOAT, false, m_Device.GetDevice(), m_MemAllocator);
+  } else {
+    m_FoveatedFB.Setup(swapChainCapabilities.minImageExtent.width, swapChainCapabilities.minImageExtent.height, fbFormat, VK_FORMAT_D32_SFLOAT, false, m_Device.GetDevice(), m_MemAllocator);
+  }
 
-  //UI framebuffer
-  m_UIFB.Setup(swapChainCapabilities.minImageExtent.width, swapChainCapabilities.minImageExtent.height, fbFormat, VK_FORMAT_UNDEFINED, false, m_Device.GetDevice(), m_MemAllocator);
+  //UI framebuffer, also the source for frame captures since it holds the finished frame without the debug UI
+  m_UIFB.Setup(swapChainCapabilities.minImageExtent.width, swapChainCapabilities.minImageExtent.height, fbFormat, VK_FORMAT_UNDEFINED, false, m_Device.GetDevice(), m_MemAllocator, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 
   //Setup shadow resolution
   if (Config::OptionExists("ShadowResolution")) {
@@ -146,16 +275,29 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   } else {
     m_ShadowSize = SHADOW_SIZE;
   }
-  m_ShadowFB.Setup(m_ShadowSize, m_ShadowSize, std::vector<VkFormat>(), VK_FORMAT_D32_SFLOAT, true, m_Device.GetDevice(), m_MemAllocator);
 
-  //Allocate command buffers for world/ui/aspect passes
-  std::vector<VkCommandBuffer> outBfrs = m_Device.AllocateCommandBuffers(VK_COMMAND_BUFFER_LEVEL_PRIMARY, 5);
+  //With a gaze cascade the shadow map holds two square cascades side by side, gaze on the left and the whole scene on the right,
+  //each at its own resolution
+  if (m_GazeShadowCascade) {
+    m_GazeShadowSize = Config::OptionExists("GazeShadowResolution") ? Config::GetOptionInt("GazeShadowResolution") : GAZE_SHADOW_SIZE;
+    m_ShadowFB.Setup(m_GazeShadowSize + m_ShadowSize, std::max(m_GazeShadowSize, m_ShadowSize), std::vector<VkFormat>(), VK_FORMAT_D32_SFLOAT, true, m_Device.GetDevice(), m_MemAllocator);
+  } else {
+    m_ShadowFB.Setup(m_ShadowSize, m_ShadowSize, std::vector<VkFormat>(), VK_FORMAT_D32_SFLOAT, true, m_Device.GetDevice(), m_MemAllocator);
+  }
 
-  m_WorldCmdBuffer = outBfrs[0];
-  m_UICmdBuffer = outBfrs[1];
-  m_PresentCmdBuffer = outBfrs[2];
-  m_ShadowCmdBuffer = outBfrs[3];
-  m_FoveatedCmdBuffer = outBfrs[4];
+  //Allocate command buffers for world/ui/aspect passes, one set per frame in flight
+  m_FrameIndex = 0;
+  m_Frames.resize(m_FramesInFlight);
+
+  for (auto &frame : m_Frames) {
+    std::vector<VkCommandBuffer> outBfrs = m_Device.AllocateCommandBuffers(VK_COMMAND_BUFFER_LEVEL_PRIMARY, 5);
+
+    frame.m_WorldCmdBuffer = outBfrs[0];
+    frame.m_UICmdBuffer = outBfrs[1];
+    frame.m_PresentCmdBuffer = outBfrs[2];
+    frame.m_ShadowCmdBuffer = outBfrs[3];
+    frame.m_FoveatedCmdBuffer = outBfrs[4];
+  }
 
   //Setup texture sampling info
   VkSamplerCreateInfo sampler = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
@@ -184,6 +326,29 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
 
   VKError::CheckResult(vkCreateSampler(m_Device.GetDevice(), &sampler, nullptr, &m_ShadowSampler), "Could not make shadow map sampler");
 
+  //Model textures use their whole mip chain, with optional anisotropic filtering
+  sampler.addressModeU = sampler.addressModeV = sampler.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  sampler.maxLod = VK_LOD_CLAMP_NONE;
+
+  const VkPhysicalDeviceLimits &limits = m_Device.GetDeviceProperties().limits;
+  float anisotropy = Config::OptionExists("TextureAnisotropy") ? (float)Config::GetOptionInt("TextureAnisotropy") : 1.0f;
+  anisotropy = std::max(1.0f, std::min(anisotropy, limits.maxSamplerAnisotropy));
+  if (anisotropy > 1.0f && m_Device.SupportsSamplerAnisotropy()) {
+    sampler.anisotropyEnable = VK_TRUE;
+    sampler.maxAnisotropy = anisotropy;
+  }
+
+  VKError::CheckResult(vkCreateSampler(m_Device.GetDevice(), &sampler, nullptr, &m_ModelTextureSampler), "Could not create model texture sampler");
+
+  //The periphery reads from smaller mips, and anisotropic filtering would be wasted there
+  float lodBias = Config::OptionExists("PeripheryTextureLODBias") ? (float)Config::GetOptionInt("PeripheryTextureLODBias") : 1.0f;
+  sampler.mipLodBias = std::max(-limits.maxSamplerLodBias, std::min(lodBias, limits.maxSamplerLodBias));
+  sampler.anisotropyEnable = VK_FALSE;
+  sampler.maxAnisotropy = 1.0f;
+
+  VKError::CheckResult(vkCreateSampler(m_Device.GetDevice(), &sampler, nullptr, &m_PeripheryTextureSampler), "Could not create periphery texture sampler");
+
   //Setup uniform data descriptor info
   
   //Camera info
@@ -191,7 +356,7 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   cameraUBOBinding.binding = 0;
   cameraUBOBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
   cameraUBOBinding.descriptorCount = 1;
-  cameraUBOBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  cameraUBOBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
   //Light info
   VkDescriptorSetLayoutBinding lightBinding = {};
@@ -235,50 +400,47 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   VKError::CheckResult(vkCreateDescriptorSetLayout(m_Device.GetDevice(), &objectSetLayout, nullptr, &m_PerObjectDescriptorSetLayout), "Could not create per object descriptor set layout");
 
   //Model matrices will be handled through a push constant
-  VkPushConstantRange pushConstant = {};
-  pushConstant.offset = 0;
-  pushConstant.size = sizeof(Mat4);
-  pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  VkPushConstantRange pushConstants[2] = {};
+  pushConstants[0].offset = 0;
+  pushConstants[0].size = sizeof(Mat4);
+  pushConstants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+  //Layer blending info for the composite shader
+  pushConstants[1].offset = sizeof(Mat4);
+  pushConstants[1].size = sizeof(Vec4);
+  pushConstants[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
   //Create pipeline layout for uniform data
   VkDescriptorSetLayout descSetLayouts[] = { m_PerFrameDescriptorSetLayout, m_PerObjectDescriptorSetLayout };
   VkPipelineLayoutCreateInfo pipelineCreate = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
   pipelineCreate.setLayoutCount = 2;
   pipelineCreate.pSetLayouts = descSetLayouts;
-  pipelineCreate.pushConstantRangeCount = 1;
-  pipelineCreate.pPushConstantRanges = &pushConstant;
+  pipelineCreate.pushConstantRangeCount = 2;
+  pipelineCreate.pPushConstantRanges = pushConstants;
   VKError::CheckResult(vkCreatePipelineLayout(m_Device.GetDevice(), &pipelineCreate, nullptr, &m_PipelineLayout), "Could not create graphics pipeline layout");
 
-  //Create buffers for uniform data
-  mCameraUBO.Setup(2 * sizeof(Mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
-  mUsrDataUBO.Setup(sizeof(Mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
-  mLightUBO.Setup(sizeof(LightData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
-
-  //Create descriptor set
-  VkDescriptorSetLayout descriptorSetLayouts[] = {m_PerFrameDescriptorSetLayout, m_PerObjectDescriptorSetLayout, m_PerObjectDescriptorSetLayout, m_PerObjectDescriptorSetLayout };
+  //Create buffers for uniform data, each holds one slice per frame in flight
+  const VkDeviceSize uboAlignment = std::max((VkDeviceSize)1, m_Device.GetDeviceProperties().limits.minUniformBufferOffsetAlignment);
+  m_UBOSliceSize = std::max((VkDeviceSize)(2 * sizeof(Mat4)), (VkDeviceSize)sizeof(LightData));
+  m_UBOSliceSize = (m_UBOSliceSize + uboAlignment - 1) / uboAlignment * uboAlignment;
+  mCameraUBO.Setup(m_FramesInFlight * m_UBOSliceSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+  mFoveatedCameraUBO.Setup(m_FramesInFlight * m_UBOSliceSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+  mUsrDataUBO.Setup(m_FramesInFlight * m_UBOSliceSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+  mLightUBO.Setup(m_FramesInFlight * m_UBOSliceSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+
+  //Create descriptor sets for the framebuffers, which are shared by every frame
+  VkDescriptorSetLayout descriptorSetLayouts[] = {m_PerObjectDescriptorSetLayout, m_PerObjectDescriptorSetLayout, m_PerObjectDescriptorSetLayout };
   VkDescriptorSetAllocateInfo descSetAllocInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
   descSetAllocInfo.descriptorPool = m_Device.GetDescriptorPool();
-  descSetAllocInfo.descriptorSetCount = 4;
+  descSetAllocInfo.descriptorSetCount = 3;
   descSetAllocInfo.pSetLayouts = descriptorSetLayouts;
 
-  std::vector<VkDescriptorSet> outSets(4);
+  std::vector<VkDescriptorSet> outSets(3);
   VKError::CheckResult(vkAllocateDescriptorSets(m_Device.GetDevice(), &descSetAllocInfo, outSets.data()), "Could not allocate global descriptor sets");
 
-  m_PerFrameDescriptorSet = outSets[0];
-  m_WorldFBDescriptorSet = outSets[1];
-  m_UIFBDescriptorSet = outSets[2];
-  m_FoveatedDescriptorSet = outSets[3];
-
-  //Associate descriptor sets with buffers
-  VkDescriptorBufferInfo cameraBufferInfo;
-  cameraBufferInfo.buffer = mCameraUBO.GetBuffer();
-  cameraBufferInfo.offset = 0;
-  cameraBufferInfo.range = 2 * sizeof(Mat4);
-
-  VkDescriptorBufferInfo usrDataBufferInfo;
-  usrDataBufferInfo.buffer = mUsrDataUBO.GetBuffer();
-  usrDataBufferInfo.offset = 0;
-  usrDataBufferInfo.range = sizeof(Mat4);
+  m_WorldFBDescriptorSet = outSets[0];
+  m_UIFBDescriptorSet = outSets[1];
+  m_FoveatedDescriptorSet = outSets[2];
 
   VkDescriptorImageInfo worldFBInfo = m_WorldFB.GetColorImageInfos(m_TextureSampler)[0];
 
@@ -288,31 +450,6 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
 
   VkDescriptorImageInfo forveatedInfo = m_FoveatedFB.GetColorImageInfos(m_TextureSampler)[0];
 
-  VkWriteDescriptorSet cameraWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
-  cameraWrite.dstSet = m_PerFrameDescriptorSet;
-  cameraWrite.dstBinding = 0;
-  cameraWrite.dstArrayElement = 0;
-  cameraWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  cameraWrite.descriptorCount = 1;
-  cameraWrite.pBufferInfo = &cameraBufferInfo;
-
-  VkWriteDescriptorSet usrWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
-  usrWrite.dstSet = m_PerFrameDescriptorSet;
-  usrWrite.dstBinding = 7;
-  usrWrite.dstArrayElement = 0;
-  usrWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  usrWrite.descriptorCount = 1;
-  usrWrite.pBufferInfo = &usrDataBufferInfo;
-
-  VkWriteDescriptorSet lightWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
-  lightWrite.dstSet = m_PerFrameDescriptorSet;
-  lightWrite.dstBinding = 1;
-  lightWrite.dstArrayElement = 0;
-  lightWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  lightWrite.descriptorCount = 1;
-  VkDescriptorBufferInfo lightInfo = mLightUBO.GetBufferInfo();
-  lightWrite.pBufferInfo = &lightInfo;
-
   VkWriteDescriptorSet worldFBWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
   worldFBWrite.dstSet = m_WorldFBDescriptorSet;
   worldFBWrite.dstBinding = 0;
@@ -337,34 +474,178 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   fovWrite.descriptorCount = 1;
   fovWrite.pImageInfo = &forveatedInfo;
 
-  VkWriteDescriptorSet shadowMapWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
-  shadowMapWrite.dstSet = m_PerFrameDescriptorSet;
-  shadowMapWrite.dstBinding = 6;
-  shadowMapWrite.dstArrayElement = 0;
-  shadowMapWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  shadowMapWrite.descriptorCount = 1;
-  shadowMapWrite.pImageInfo = &shadowMapInfo;
+  VkWriteDescriptorSet fbWrites[] = { worldFBWrite, uiFBWrite, fovWrite };
 
-  VkWriteDescriptorSet descWrites[] = { cameraWrite, lightWrite, usrWrite, worldFBWrite, uiFBWrite, shadowMapWrite, fovWrite };
+  vkUpdateDescriptorSets(m_Device.GetDevice(), 3, fbWrites, 0, nullptr);
 
-  vkUpdateDescriptorSets(m_Device.GetDevice(), 7, descWrites, 0, nullptr);
+  //Reprojection and upsampling read the base pass depth from the shadow map slot of their own per frame set
+  m_FramesSinceBaseRender = 0;
+  m_BaseHistoryValid = false;
+  m_BaseHistoryViewProj = Mat4(1.0f);
+  m_BaseHistoryExtent = m_WorldExtent;
+  VkDescriptorImageInfo worldDepthInfo = {};
+  if (storeWorldDepth) {
+    worldDepthInfo = m_WorldFB.GetDepthImageInfo(m_ShadowSampler);
+  }
 
-  //Create semaphores
-  VkSemaphoreCreateInfo semaCreate = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-  VKError::CheckResult(vkCreateSemaphore(m_Device.GetDevice(), &semaCreate, nullptr, &m_ImageAvailable), "Could not create image available semaphore");
-  VKError::CheckResult(vkCreateSemaphore(m_Device.GetDevice(), &semaCreate, nullptr, &m_RenderFinished), "Could not create render finished semaphore");
-  VKError::CheckResult(vkCreateSemaphore(m_Device.GetDevice(), &semaCreate, nullptr, &m_ShadowToFoveated), "Could not create shadow to foveated semaphore");
+  //The reprojection matrix takes the place of the camera data
+  if (m_PeripheryUpdateRate > 1) {
+    mReprojectUBO.Setup(m_FramesInFlight * m_UBOSliceSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+    mReprojectUBO.Map(m_MemAllocator);
+  }
 
-  //Create fence for syncing with last frame
+  //Each frame in flight gets its own per frame sets, pointing at its slices of the uniform buffers
+  for (u32 i = 0; i < m_FramesInFlight; i++) {
+    FrameResources &frame = m_Frames[i];
+
+    VkDescriptorSetLayout frameSetLayouts[] = {m_PerFrameDescriptorSetLayout, m_PerFrameDescriptorSetLayout};
+    descSetAllocInfo.descriptorSetCount = 2;
+    descSetAllocInfo.pSetLayouts = frameSetLayouts;
+
+    VkDescriptorSet frameSets[2];
+    VKError::CheckResult(vkAllocateDescriptorSets(m_Device.GetDevice(), &descSetAllocInfo, frameSets), "Could not allocate per frame descriptor sets");
+
+    frame.m_PerFrameDescriptorSet = frameSets[0];
+    frame.m_FoveatedPerFrameDescriptorSet = frameSets[1];
+
+    //Associate descriptor sets with buffers
+    VkDescriptorBufferInfo cameraBufferInfo = mCameraUBO.GetBufferInfo(i * m_UBOSliceSize, 2 * sizeof(Mat4));
+
+    //The foveated pass gets its own camera data so it can use a different projection
+    VkDescriptorBufferInfo fovCameraBufferInfo = mFoveatedCameraUBO.GetBufferInfo(i * m_UBOSliceSize, 2 * sizeof(Mat4));
+
+    VkDescriptorBufferInfo usrDataBufferInfo = mUsrDataUBO.GetBufferInfo(i * m_UBOSliceSize, sizeof(Mat4));
+
+    VkDescriptorBufferInfo lightInfo = mLightUBO.GetBufferInfo(i * m_UBOSliceSize, sizeof(LightData));
+
+    VkWriteDescriptorSet cameraWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    cameraWrite.dstSet = frame.m_PerFrameDescriptorSet;
+    cameraWrite.dstBinding = 0;
+    cameraWrite.dstArrayElement = 0;
+    cameraWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cameraWrite.descriptorCount = 1;
+    cameraWrite.pBufferInfo = &cameraBufferInfo;
+
+    VkWriteDescriptorSet usrWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    usrWrite.dstSet = frame.m_PerFrameDescriptorSet;
+    usrWrite.dstBinding = 7;
+    usrWrite.dstArrayElement = 0;
+    usrWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    usrWrite.descriptorCount = 1;
+    usrWrite.pBufferInfo = &usrDataBufferInfo;
+
+    VkWriteDescriptorSet lightWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    lightWrite.dstSet = frame.m_PerFrameDescriptorSet;
+    lightWrite.dstBinding = 1;
+    lightWrite.dstArrayElement = 0;
+    lightWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    lightWrite.descriptorCount = 1;
+    lightWrite.pBufferInfo = &lightInfo;
+
+    VkWriteDescriptorSet shadowMapWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    shadowMapWrite.dstSet = frame.m_PerFrameDescriptorSet;
+    shadowMapWrite.dstBinding = 6;
+    shadowMapWrite.dstArrayElement = 0;
+    shadowMapWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    shadowMapWrite.descriptorCount = 1;
+    shadowMapWrite.pImageInfo = &shadowMapInfo;
+
+    //Foveated pass shares everything except the camera data
+    VkWriteDescriptorSet fovCameraWrite = cameraWrite;
+    fovCameraWrite.dstSet = frame.m_FoveatedPerFrameDescriptorSet;
+    fovCameraWrite.pBufferInfo = &fovCameraBufferInfo;
+
+    VkWriteDescriptorSet fovUsrWrite = usrWrite;
+    fovUsrWrite.dstSet = frame.m_FoveatedPerFrameDescriptorSet;
+
+    VkWriteDescriptorSet fovLightWrite = lightWrite;
+    fovLightWrite.dstSet = frame.m_FoveatedPerFrameDescriptorSet;
+
+    VkWriteDescriptorSet fovShadowMapWrite = shadowMapWrite;
+    fovShadowMapWrite.dstSet = frame.m_FoveatedPerFrameDescriptorSet;
+
+    VkWriteDescriptorSet descWrites[] = { cameraWrite, lightWrite, usrWrite, shadowMapWrite,
+                                          fovCameraWrite, fovUsrWrite, fovLightWrite, fovShadowMapWrite };
+
+    vkUpdateDescriptorSets(m_Device.GetDevice(), 8, descWrites, 0, nullptr);
+
+    frame.m_WorldDepthDescriptorSet = VK_NULL_HANDLE;
+    if (storeWorldDepth) {
+      VkDescriptorSetAllocateInfo depthAllocInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+      depthAllocInfo.descriptorPool = m_Device.GetDescriptorPool();
+      depthAllocInfo.descriptorSetCount = 1;
+      depthAllocInfo.pSetLayouts = &m_PerFrameDescriptorSetLayout;
+      VKError::CheckResult(vkAllocateDescriptorSets(m_Device.GetDevice(), &depthAllocInfo, &frame.m_WorldDepthDescriptorSet), "Could not allocate world depth descriptor set");
+
+      VkWriteDescriptorSet worldDepthWrite = shadowMapWrite;
+      worldDepthWrite.dstSet = frame.m_WorldDepthDescriptorSet;
+      worldDepthWrite.pImageInfo = &worldDepthInfo;
+
+      std::vector<VkWriteDescriptorSet> depthWrites = { worldDepthWrite };
+
+      VkDescriptorBufferInfo reprojectInfo;
+      if (m_PeripheryUpdateRate > 1) {
+        reprojectInfo = mReprojectUBO.GetBufferInfo(i * m_UBOSliceSize, sizeof(Mat4));
+
+        VkWriteDescriptorSet reprojectWrite = cameraWrite;
+        reprojectWrite.dstSet = frame.m_WorldDepthDescriptorSet;
+        reprojectWrite.pBufferInfo = &reprojectInfo;
+        depthWrites.push_back(reprojectWrite);
+      }
+
+      vkUpdateDescriptorSets(m_Device.GetDevice(), depthWrites.size(), depthWrites.data(), 0, nullptr);
+    }
+  }
+
+  SetupFoveationLayers();
+
+  //Create semaphores and fences for each frame in flight
+  VkSemaphoreCreateInfo semaCreate = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
   VkFenceCreateInfo fenceCreate = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
   fenceCreate.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-  VKError::CheckResult(vkCreateFence(m_Device.GetDevice(), &fenceCreate, nullptr, &m_LastFrameFinished), "Could not make frame sync fence");
+  for (auto &frame : m_Frames) {
+    VKError::CheckResult(vkCreateSemaphore(m_Device.GetDevice(), &semaCreate, nullptr, &frame.m_ImageAvailable), "Could not create image available semaphore");
+    VKError::CheckResult(vkCreateSemaphore(m_Device.GetDevice(), &semaCreate, nullptr, &frame.m_RenderFinished), "Could not create render finished semaphore");
+    VKError::CheckResult(vkCreateSemaphore(m_Device.GetDevice(), &semaCreate, nullptr, &frame.m_ShadowToFoveated), "Could not create shadow to foveated semaphore");
+    VKError::CheckResult(vkCreateFence(m_Device.GetDevice(), &fenceCreate, nullptr, &frame.m_Finished), "Could not make frame sync fence");
+  }
+
+  //Create timestamp queries for timing each pass
+  m_TimestampPool = VK_NULL_HANDLE;
+  m_TimestampFrame = 0;
+  m_GPUFrameTime = 0.0f;
+  for (auto &passTime : m_PassTimes) {
+    passTime = 0.0f;
+  }
+  for (int i = 0; i < (int)TIMED_PASS::COUNT; i++) {
+    m_CPUPassStart[i] = 0;
+    m_CPUPassTimes[i] = 0.0f;
+  }
+
+  if (m_Device.GetGraphicsTimestampBits() > 0) {
+    VkQueryPoolCreateInfo queryCreate = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryCreate.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryCreate.queryCount = m_FramesInFlight * 2 * (u32)TIMED_PASS::COUNT;
+    VKError::CheckResult(vkCreateQueryPool(m_Device.GetDevice(), &queryCreate, nullptr, &m_TimestampPool), "Could not create timestamp query pool");
+  } else {
+    Log::LogWarning("[VKBackend] Graphics queue does not support timestamps, GPU pass timings are unavailable");
+  }
 
-  //Create staging buffer to use for model and texture uploads
-  m_StagingBuffer.Setup(STAGING_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+  m_FoveationController.Setup(MIN_FOVEATED_SIZE, MAX_FOVEATED_SIZE);
+
+  //Create the staging ring that model and texture uploads are batched through
+  m_Uploader.Setup(&m_Device, m_MemAllocator, STAGING_BUFFER_SIZE);
+
+  //Create the arena meshes are sub-allocated from, sized in millions of vertices with room for 3 indices each
+  u32 arenaVertices = GEOMETRY_ARENA_VERTICES;
+  if (Config::OptionExists("GeometryArenaVertices")) {
+    arenaVertices = (u32)std::max(1, std::min(MAX_GEOMETRY_ARENA_MILLIONS, Config::GetOptionInt("GeometryArenaVertices"))) * 1000000;
+  }
+  m_GeometryArena.Setup(&m_Device, m_MemAllocator, arenaVertices, arenaVertices * 3);
 
   //Map camera and user data ubo for faster writes in draw loop
   mCameraUBO.Map(m_MemAllocator);
+  mFoveatedCameraUBO.Map(m_MemAllocator);
   mUsrDataUBO.Map(m_MemAllocator);
   mLightUBO.Map(m_MemAllocator);
 
@@ -376,6 +657,7 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   imguiInit.Device = m_Device.GetDevice();
   imguiInit.Queue = m_Device.GetGraphicsQueue();
   imguiInit.DescriptorPool = m_Device.GetDescriptorPool();
+  imguiInit.PipelineCache = m_PipelineCache;
 
   ImGui_ImplVulkan_Init(&imguiInit, m_Surface.GetRenderPass());
 
@@ -393,28 +675,69 @@ void VKBackend::WindowInit(const std::string name, int width, const int height)
   m_DummyImage = static_cast<VKTexture*>(LoadTexture(dummyImageData, 2, 2, 4));
 
   m_FoveatedClearShader = static_cast<VKShader*>(RenderFrontend::LoadShader("fbo.vert", "fbo_foveated.frag", DRAW_STAGE::FOVEATED));
+
+  //Soft edges between foveation layers
+  m_CompositeShader = nullptr;
+  m_BlendWidth = 0.0f;
+  if (Config::OptionExists("FoveationBlendWidth")) {
+    m_BlendWidth = (float)std::max(1, Config::GetOptionInt("FoveationBlendWidth"));
+    m_CompositeShader = static_cast<VKShader*>(RenderFrontend::LoadShader("fbo.vert", "composite.frag", DRAW_STAGE::UI));
+  }
+
+  m_ReprojectShader = nullptr;
+  if (m_PeripheryUpdateRate > 1) {
+    m_ReprojectShader = static_cast<VKShader*>(RenderFrontend::LoadShader("fbo.vert", "reproject.frag", DRAW_STAGE::UI));
+  }
+
+  //Joint bilateral upsampling of the base pass, guided by its own depth
+  m_UpsampleShader = nullptr;
+  m_UpsampleSensitivity = 0.0f;
+  if (baseUpsample) {
+    m_UpsampleSensitivity = Config::OptionExists("UpsampleDepthSensitivity") ? (float)Config::GetOptionInt("UpsampleDepthSensitivity") : 20.0f;
+    m_UpsampleShader = static_cast<VKShader*>(RenderFrontend::LoadShader("fbo.vert", "upsample.frag", DRAW_STAGE::UI));
+  }
 }
 
 void VKBackend::Shutdown() {
+  m_PipelineCompiler.Stop();
   vkDeviceWaitIdle(m_Device.GetDevice());
+  SavePipelineCache();
+  vkDestroyPipelineCache(m_Device.GetDevice(), m_PipelineCache, nullptr);
   ImGui_ImplVulkan_Shutdown();
   ImGui::DestroyContext();
   DeleteTexture(m_DummyImage);
   mCameraUBO.UnMap(m_MemAllocator);
+  mFoveatedCameraUBO.UnMap(m_MemAllocator);
   mUsrDataUBO.UnMap(m_MemAllocator);
   mLightUBO.UnMap(m_MemAllocator);
-  vkDestroySemaphore(m_Device.GetDevice(), m_ImageAvailable, nullptr);
-  vkDestroySemaphore(m_Device.GetDevice(), m_RenderFinished, nullptr);
-  vkDestroySemaphore(m_Device.GetDevice(), m_ShadowToFoveated, nullptr);
-  vkDestroyFence(m_Device.GetDevice(), m_LastFrameFinished, nullptr);
-  m_Device.FreeCommandBuffers({m_WorldCmdBuffer, m_UICmdBuffer, m_PresentCmdBuffer, m_ShadowCmdBuffer, m_FoveatedCmdBuffer});
+  for (FrameResources &frame : m_Frames) {
+    vkDestroySemaphore(m_Device.GetDevice(), frame.m_ImageAvailable, nullptr);
+    vkDestroySemaphore(m_Device.GetDevice(), frame.m_RenderFinished, nullptr);
+    vkDestroySemaphore(m_Device.GetDevice(), frame.m_ShadowToFoveated, nullptr);
+    vkDestroyFence(m_Device.GetDevice(), frame.m_Finished, nullptr);
+    m_Device.FreeCommandBuffers({frame.m_WorldCmdBuffer, frame.m_UICmdBuffer, frame.m_PresentCmdBuffer, frame.m_ShadowCmdBuffer, frame.m_FoveatedCmdBuffer});
+  }
+  if (m_TimestampPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(m_Device.GetDevice(), m_TimestampPool, nullptr);
+  }
   vkDestroySampler(m_Device.GetDevice(), m_TextureSampler, nullptr);
   vkDestroySampler(m_Device.GetDevice(), m_ShadowSampler, nullptr);
+  vkDestroySampler(m_Device.GetDevice(), m_ModelTextureSampler, nullptr);
+  vkDestroySampler(m_Device.GetDevice(), m_PeripheryTextureSampler, nullptr);
   mCameraUBO.Destroy(m_MemAllocator);
+  mFoveatedCameraUBO.Destroy(m_MemAllocator);
   mUsrDataUBO.Destroy(m_MemAllocator);
   mLightUBO.Destroy(m_MemAllocator);
-  m_StagingBuffer.UnMap(m_MemAllocator);
-  m_StagingBuffer.Destroy(m_MemAllocator);
+  if (m_PeripheryUpdateRate > 1) {
+    mReprojectUBO.UnMap(m_MemAllocator);
+    mReprojectUBO.Destroy(m_MemAllocator);
+  }
+  m_Uploader.Destroy();
+  m_GeometryArena.Destroy();
+  if (m_CaptureBufferCreated) {
+    m_CaptureBuffer.UnMap(m_MemAllocator);
+    m_CaptureBuffer.Destroy(m_MemAllocator);
+  }
   vkDestroyDescriptorSetLayout(m_Device.GetDevice(), m_PerFrameDescriptorSetLayout, nullptr);
   vkDestroyDescriptorSetLayout(m_Device.GetDevice(), m_PerObjectDescriptorSetLayout, nullptr);
   vkDestroyPipelineLayout(m_Device.GetDevice(), m_PipelineLayout, nullptr);
@@ -422,6 +745,11 @@ void VKBackend::Shutdown() {
   m_UIFB.Destroy(m_Device.GetDevice(), m_MemAllocator);
   m_ShadowFB.Destroy(m_Device.GetDevice(), m_MemAllocator);
   m_FoveatedFB.Destroy(m_Device.GetDevice(), m_MemAllocator);
+  for (auto &layer : m_FoveationLayers) {
+    layer.mCameraUBO.UnMap(m_MemAllocator);
+    layer.mCameraUBO.Destroy(m_MemAllocator);
+    layer.m_FB.Destroy(m_Device.GetDevice(), m_MemAllocator);
+  }
   vmaDestroyAllocator(m_MemAllocator);
   m_Surface.Destroy(m_Instance, m_Device.GetDevice());
   m_Device.DestroyDevice();
@@ -430,45 +758,76 @@ void VKBackend::Shutdown() {
   }
   vkDestroyInstance(m_Instance, nullptr);
 
+  GazeTrace::Shutdown();
   GazePointManager::FreeDevices();
 }
 
 const Model VKBackend::LoadModel(const std::vector<Vertex> vertices, const std::vector<u32> indices) {
   Model m;
   VKVertexBuffer *vBuffer = new VKVertexBuffer;
+  vBuffer->m_VertexCount = (u32)vertices.size();
+  vBuffer->m_IndexCount = (u32)indices.size();
+  vBuffer->m_FirstVertex = 0;
+  vBuffer->m_FirstIndex = 0;
+
+  const VkDeviceSize vertexSize = vertices.size() * sizeof(Vertex);
+  const VkDeviceSize indexSize = indices.size() * sizeof(u32);
+
+  //Meshes normally share the geometry arena, only ones that don't fit get a buffer of their own
+  vBuffer->m_InArena = m_GeometryArena.Allocate(vBuffer->m_VertexCount, vBuffer->m_IndexCount, vBuffer->m_FirstVertex, vBuffer->m_FirstIndex);
+  if (vBuffer->m_InArena) {
+    vBuffer->m_Buffer = m_GeometryArena.GetVertexBuffer();
+    vBuffer->m_Allocation = VK_NULL_HANDLE;
+    vBuffer->m_IndexBuffer = m_GeometryArena.GetIndexBuffer();
+    vBuffer->m_IndexOffset = 0;
+  } else {
+    Log::LogWarning("[VKBackend] Geometry arena is full, mesh gets its own buffer");
 
-  //Allocate memory for vertices
-  VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-  bufferInfo.size = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(u32);
-  bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    //Allocate memory for vertices
+    VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = vertexSize + indexSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  VmaAllocationCreateInfo allocInfo = {};
-  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-  vmaCreateBuffer(m_MemAllocator, &bufferInfo, &allocInfo,
-                  &vBuffer->m_Buffer, &vBuffer->m_Allocation, nullptr);
+    vmaCreateBuffer(m_MemAllocator, &bufferInfo, &allocInfo,
+                    &vBuffer->m_Buffer, &vBuffer->m_Allocation, nullptr);
+    vBuffer->m_IndexBuffer = vBuffer->m_Buffer;
+    vBuffer->m_IndexOffset = vertexSize;
+  }
 
   m.mVBuffer = vBuffer;
-  vBuffer->m_IndexOffset = vertices.size() * sizeof(Vertex);
 
-  //Copy over vertex and index data
-  void* data = m_StagingBuffer.Map(m_MemAllocator);
-  void* indexData;
-  memcpy(data, vertices.data(), (size_t)(vertices.size() * sizeof(Vertex)));
+  //Copy over vertex and index data, the copy is submitted with the rest of the batch before the next frame
+  StagingRegion staging = m_Uploader.Stage(vertexSize + indexSize, sizeof(u32));
+  memcpy(staging.mData, vertices.data(), (size_t)vertexSize);
+  memcpy(static_cast<char*>(staging.mData) + vertexSize, indices.data(), (size_t)indexSize);
 
-  indexData = static_cast<char*>(data) + vBuffer->m_IndexOffset;
+  VkBufferCopy vertexCopy = {};
+  vertexCopy.size = vertexSize;
+  vertexCopy.srcOffset = staging.mOffset;
+  vertexCopy.dstOffset = (VkDeviceSize)vBuffer->m_FirstVertex * sizeof(Vertex);
 
-  memcpy(indexData, indices.data(), (size_t)(indices.size() * sizeof(u32)));
+  VkBufferCopy indexCopy = {};
+  indexCopy.size = indexSize;
+  indexCopy.srcOffset = staging.mOffset + vertexSize;
+  indexCopy.dstOffset = vBuffer->m_IndexOffset + (VkDeviceSize)vBuffer->m_FirstIndex * sizeof(u32);
 
-  VkCommandBuffer copyCommand = MakeOneTimeBuffer();
+  VkCommandBuffer copyCmd = m_Uploader.GetTransferCommands();
+  if (vertexSize > 0) {
+    vkCmdCopyBuffer(copyCmd, staging.mBuffer, vBuffer->m_Buffer, 1, &vertexCopy);
+  }
+  if (indexSize > 0) {
+    vkCmdCopyBuffer(copyCmd, staging.mBuffer, vBuffer->m_IndexBuffer, 1, &indexCopy);
+  }
 
-  VkBufferCopy bufferCopy = {};
-  bufferCopy.size = bufferInfo.size;
-  bufferCopy.srcOffset = 0;
-  bufferCopy.dstOffset = 0;
-  vkCmdCopyBuffer(copyCommand, m_StagingBuffer.GetBuffer(), vBuffer->m_Buffer, 1, &bufferCopy);
-  SubmitOneTimeBuffer(m_Device.GetGraphicsQueue(), copyCommand);
+  //The arena is shared by both queue families, so only a buffer of its own changes owner
+  if (!vBuffer->m_InArena) {
+    m_Uploader.TransferOwnership(vBuffer->m_Buffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+  }
+  m_Uploader.MakeVisibleToVertexInput();
   return m;
 }
 
@@ -494,16 +853,25 @@ Texture* VKBackend::LoadTexture(const unsigned char* data, const int width, cons
       imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
       break;
     }
-    texture->m_Image.Setup((u32)width, (u32)height, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_Device.GetDevice(), m_MemAllocator);
-    //Use staging buffer to upload data
-
+    //Build a full mip chain when the format can be blitted with linear filtering
+    u32 mipLevels = 1;
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_Device.GetPhysicalDevice(), imageFormat, &formatProperties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures) {
+      mipLevels = (u32)std::floor(std::log2((float)std::max(width, height))) + 1;
+      usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
 
-    //Copy image into staging buffer
-    void* dst_data = m_StagingBuffer.Map(m_MemAllocator);
-    memcpy(dst_data, data, width * height * numChannels);
+    texture->m_Image.Setup((u32)width, (u32)height, usage, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_Device.GetDevice(), m_MemAllocator, mipLevels);
+    //Copy image into staging memory, offsets have to be a multiple of both the texel size and 4
+    const VkDeviceSize imageSize = (VkDeviceSize)width * height * numChannels;
+    StagingRegion staging = m_Uploader.Stage(imageSize, (VkDeviceSize)numChannels * 4);
+    memcpy(staging.mData, data, (size_t)imageSize);
 
     //Transition image to transfer destination layout
-    VkCommandBuffer transitionCmd = MakeOneTimeBuffer();
+    VkCommandBuffer transitionCmd = m_Uploader.GetTransferCommands();
 
     VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
     barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -514,7 +882,7 @@ Texture* VKBackend::LoadTexture(const unsigned char* data, const int width, cons
     barrier.image = texture->m_Image.GetImage();
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
     barrier.srcAccessMask = 0;
@@ -524,7 +892,7 @@ Texture* VKBackend::LoadTexture(const unsigned char* data, const int width, cons
 
     //Copy staging buffer to image
     VkBufferImageCopy bufferToImage = {};
-    bufferToImage.bufferOffset = 0;
+    bufferToImage.bufferOffset = staging.mOffset;
     bufferToImage.bufferRowLength = 0;
     bufferToImage.bufferImageHeight = 0;
     bufferToImage.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -534,9 +902,46 @@ Texture* VKBackend::LoadTexture(const unsigned char* data, const int width, cons
     bufferToImage.imageOffset = {0, 0, 0};
     bufferToImage.imageExtent = {(u32)width, (u32)height, 1};
 
-    vkCmdCopyBufferToImage(transitionCmd, m_StagingBuffer.GetBuffer(), texture->m_Image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferToImage);
+    vkCmdCopyBufferToImage(transitionCmd, staging.mBuffer, texture->m_Image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferToImage);
+
+    //Blits need a graphics queue, so the rest runs after the batch's copies
+    m_Uploader.TransferOwnership(texture->m_Image.GetImage(), mipLevels);
+    VkCommandBuffer mipCmd = m_Uploader.GetGraphicsCommands();
+
+    //Downsample each mip from the one above, moving the finished level to shader read layout
+    VkImageMemoryBarrier mipBarrier = barrier;
+    mipBarrier.subresourceRange.levelCount = 1;
+    int32_t mipWidth = width;
+    int32_t mipHeight = height;
+    for (u32 level = 1; level < mipLevels; level++) {
+      mipBarrier.subresourceRange.baseMipLevel = level - 1;
+      mipBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      mipBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      mipBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      mipBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      vkCmdPipelineBarrier(mipCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &mipBarrier);
+
+      VkImageBlit blit = {};
+      blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.srcSubresource.mipLevel = level - 1;
+      blit.srcSubresource.layerCount = 1;
+      blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+      blit.dstSubresource = blit.srcSubresource;
+      blit.dstSubresource.mipLevel = level;
+      mipWidth = std::max(1, mipWidth / 2);
+      mipHeight = std::max(1, mipHeight / 2);
+      blit.dstOffsets[1] = {mipWidth, mipHeight, 1};
+      vkCmdBlitImage(mipCmd, texture->m_Image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     texture->m_Image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+      mipBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      mipBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      mipBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vkCmdPipelineBarrier(mipCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &mipBarrier);
+    }
 
-    //Transition image to optimal shader read layout
+    //Transition the last mip to optimal shader read layout
     VkImageMemoryBarrier barrier2 = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
     barrier2.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
     barrier2.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -544,31 +949,36 @@ Texture* VKBackend::LoadTexture(const unsigned char* data, const int width, cons
     barrier2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier2.image = texture->m_Image.GetImage();
     barrier2.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier2.subresourceRange.baseMipLevel = 0;
+    barrier2.subresourceRange.baseMipLevel = mipLevels - 1;
     barrier2.subresourceRange.levelCount = 1;
     barrier2.subresourceRange.baseArrayLayer = 0;
     barrier2.subresourceRange.layerCount = 1;
     barrier2.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier2.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    vkCmdPipelineBarrier(transitionCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier2);
+    vkCmdPipelineBarrier(mipCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier2);
 
-    SubmitOneTimeBuffer(m_Device.GetGraphicsQueue(), transitionCmd);
-
-    //Create descriptor set
+    //Create descriptor sets, one per sampler
+    VkDescriptorSetLayout textureSetLayouts[] = { m_PerObjectDescriptorSetLayout, m_PerObjectDescriptorSetLayout };
     VkDescriptorSetAllocateInfo descSetAlloc = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
     descSetAlloc.descriptorPool = m_Device.GetDescriptorPool();
-    descSetAlloc.descriptorSetCount = 1;
-    descSetAlloc.pSetLayouts = &m_PerObjectDescriptorSetLayout;
+    descSetAlloc.descriptorSetCount = 2;
+    descSetAlloc.pSetLayouts = textureSetLayouts;
 
-    VKError::CheckResult(vkAllocateDescriptorSets(m_Device.GetDevice(), &descSetAlloc, &texture->m_TextureDescriptorSet), "Could not allocate texture descriptor set");
+    VkDescriptorSet textureSets[2];
+    VKError::CheckResult(vkAllocateDescriptorSets(m_Device.GetDevice(), &descSetAlloc, textureSets), "Could not allocate texture descriptor sets, the descriptor pool is full");
+    texture->m_TextureDescriptorSet = textureSets[0];
+    texture->m_PeripheryDescriptorSet = textureSets[1];
 
-    //Update descriptor set to point to texture
+    //Update descriptor sets to point to texture
     VkDescriptorImageInfo descImageInfo = {};
-    descImageInfo.sampler = m_TextureSampler;
+    descImageInfo.sampler = m_ModelTextureSampler;
     descImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     descImageInfo.imageView = texture->m_Image.GetImageView();
 
+    VkDescriptorImageInfo peripheryImageInfo = descImageInfo;
+    peripheryImageInfo.sampler = m_PeripheryTextureSampler;
+
     VkWriteDescriptorSet texWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
     texWrite.dstSet = texture->m_TextureDescriptorSet;
     texWrite.dstBinding = 0;
@@ -577,9 +987,15 @@ Texture* VKBackend::LoadTexture(const unsigned char* data, const int width, cons
     texWrite.descriptorCount = 1;
     texWrite.pImageInfo = &descImageInfo;
 
-    vkUpdateDescriptorSets(m_Device.GetDevice(), 1, &texWrite, 0, nullptr);
+    VkWriteDescriptorSet peripheryWrite = texWrite;
+    peripheryWrite.dstSet = texture->m_PeripheryDescriptorSet;
+    peripheryWrite.pImageInfo = &peripheryImageInfo;
+
+    VkWriteDescriptorSet texWrites[] = { texWrite, peripheryWrite };
+    vkUpdateDescriptorSets(m_Device.GetDevice(), 2, texWrites, 0, nullptr);
   } else     {
     texture->m_TextureDescriptorSet = VK_NULL_HANDLE;
+    texture->m_PeripheryDescriptorSet = VK_NULL_HANDLE;
   }
 
   texture->mHeight = (u32)height;
@@ -590,23 +1006,32 @@ Texture* VKBackend::LoadTexture(const unsigned char* data, const int width, cons
 
 Shader* VKBackend::CreateShader(const std::vector<char> vertexProgram, const std::vector<char> fragmentProgram, const DRAW_STAGE stage) {
   VKShader* shader = new VKShader;
-  VkShaderModule vertModule;
-  VkShaderModule fragModule;
-
-  //Create shader modules
-  VkShaderModuleCreateInfo create = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-  create.codeSize = vertexProgram.size();
-  create.pCode = reinterpret_cast<const u32*>(vertexProgram.data());
-
-  VKError::CheckResult(vkCreateShaderModule(m_Device.GetDevice(), &create, nullptr, &vertModule), "Could not create vertex shader module");
-
-  create.codeSize = fragmentProgram.size();
-  create.pCode = reinterpret_cast<const u32*>(fragmentProgram.data());
+  VkRenderPass rp;
+  VkExtent2D extent;
+  GetStageTarget(stage, rp, extent);
 
-  VKError::CheckResult(vkCreateShaderModule(m_Device.GetDevice(), &create, nullptr, &fragModule), "Could not create fragment shader module");
+  BuildShaderPipeline(shader, vertexProgram, fragmentProgram, rp, extent);
+  return shader;
+}
+Shader* VKBackend::CreateShaderAsync(const std::vector<char> vertexProgram, const std::vector<char> fragmentProgram, const DRAW_STAGE stage) {
+  VKShader* shader = new VKShader;
+  shader->m_Ready = false;
 
+  //The target is picked now, so the job doesn't read framebuffers the render thread may be changing
   VkRenderPass rp;
-  VkExtent2D extent = m_Surface.GetSwapchainExtent();
+  VkExtent2D extent;
+  GetStageTarget(stage, rp, extent);
+
+  m_PipelineCompiler.Submit([this, shader, vertexProgram, fragmentProgram, rp, extent]() {
+    BuildShaderPipeline(shader, vertexProgram, fragmentProgram, rp, extent);
+  });
+  return shader;
+}
+bool VKBackend::IsShaderReady(Shader* shader) {
+  return shader != nullptr && static_cast<VKShader*>(shader)->m_Ready;
+}
+void VKBackend::GetStageTarget(const DRAW_STAGE stage, VkRenderPass &rp, VkExtent2D &extent) {
+  extent = m_Surface.GetSwapchainExtent();
 
   switch (stage) {
   case DRAW_STAGE::WORLD:
@@ -621,20 +1046,35 @@ Shader* VKBackend::CreateShader(const std::vector<char> vertexProgram, const std
     break;
   case DRAW_STAGE::SHADOW:
     rp = m_ShadowFB.GetRenderPass();
-    extent = {m_ShadowSize, m_ShadowSize};
+    extent = {m_ShadowFB.GetWidth(), m_ShadowFB.GetHeight()};
     break;
   case DRAW_STAGE::FOVEATED:
     rp = m_FoveatedFB.GetRenderPass();
     break;
   }
+}
+void VKBackend::BuildShaderPipeline(VKShader* shader, const std::vector<char> &vertexProgram, const std::vector<char> &fragmentProgram, const VkRenderPass rp, const VkExtent2D extent) {
+  VkShaderModule vertModule;
+  VkShaderModule fragModule;
+
+  //Create shader modules
+  VkShaderModuleCreateInfo create = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+  create.codeSize = vertexProgram.size();
+  create.pCode = reinterpret_cast<const u32*>(vertexProgram.data());
+
+  VKError::CheckResult(vkCreateShaderModule(m_Device.GetDevice(), &create, nullptr, &vertModule), "Could not create vertex shader module");
+
+  create.codeSize = fragmentProgram.size();
+  create.pCode = reinterpret_cast<const u32*>(fragmentProgram.data());
+
+  VKError::CheckResult(vkCreateShaderModule(m_Device.GetDevice(), &create, nullptr, &fragModule), "Could not create fragment shader module");
 
   shader->m_Pipeline = CreateGraphicsPipeline(vertModule, fragModule, rp, extent);
 
   vkDestroyShaderModule(m_Device.GetDevice(), vertModule, nullptr);
   vkDestroyShaderModule(m_Device.GetDevice(), fragModule, nullptr);
-  return shader;
+  shader->m_Ready = true;
 }
-
 void VKBackend::SetFrameBufferModel(const Model &model) {
   m_FBModel = model;
 }
@@ -654,23 +1094,33 @@ void VKBackend::SetFrameBufferShader(Shader* shader, const DRAW_STAGE stage) {
 }
 
 void VKBackend::DeleteModel(Model &model) {
+  m_Uploader.Flush();
   vkDeviceWaitIdle(m_Device.GetDevice());
   VKVertexBuffer* vBuffer = static_cast<VKVertexBuffer*>(model.mVBuffer);
-  vmaDestroyBuffer(m_MemAllocator, vBuffer->m_Buffer, vBuffer->m_Allocation);
+  if (vBuffer->m_InArena) {
+    m_GeometryArena.Free(vBuffer->m_FirstVertex, vBuffer->m_VertexCount, vBuffer->m_FirstIndex, vBuffer->m_IndexCount);
+  } else {
+    vmaDestroyBuffer(m_MemAllocator, vBuffer->m_Buffer, vBuffer->m_Allocation);
+  }
 }
 void VKBackend::DeleteTexture(Texture* tex) {
   VKTexture* t = static_cast<VKTexture*>(tex);
+  m_Uploader.Flush();
   vkDeviceWaitIdle(m_Device.GetDevice());
 
   t->m_Image.Destroy(m_Device.GetDevice(), m_MemAllocator);
   if (t->m_TextureDescriptorSet != VK_NULL_HANDLE) {
-    vkFreeDescriptorSets(m_Device.GetDevice(), m_Device.GetDescriptorPool(), 1, &t->m_TextureDescriptorSet);
+    VkDescriptorSet textureSets[] = { t->m_TextureDescriptorSet, t->m_PeripheryDescriptorSet };
+    vkFreeDescriptorSets(m_Device.GetDevice(), m_Device.GetDescriptorPool(), 2, textureSets);
   }
 }
 
 void VKBackend::DeleteShader(Shader* shader) {
-  vkDeviceWaitIdle(m_Device.GetDevice());
   VKShader* s = static_cast<VKShader*>(shader);
+  if (!s->m_Ready) {
+    m_PipelineCompiler.WaitIdle();
+  }
+  vkDeviceWaitIdle(m_Device.GetDevice());
   vkDestroyPipeline(m_Device.GetDevice(), s->m_Pipeline, nullptr);
 }
 
@@ -811,7 +1261,7 @@ VkPipeline VKBackend::CreateGraphicsPipeline(const VkShaderModule vertexModule,
   createInfo.subpass = 0;
 
   VkPipeline ret;
-  vkCreateGraphicsPipelines(m_Device.GetDevice(), VK_NULL_HANDLE, 1, &createInfo, nullptr, &ret);
+  vkCreateGraphicsPipelines(m_Device.GetDevice(), m_PipelineCache, 1, &createInfo, nullptr, &ret);
   return ret;
 }
 
@@ -849,10 +1299,24 @@ static auto vector_getter = [](void* vec, int idx, const char** out_text) {
   return true;
 };
 
-void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4 &userData, const std::vector<Drawable> &scene, const std::vector<Drawable> &ui, const LightData& lights) {
-  //Wait for last frame to finish rendering
-  vkWaitForFences(m_Device.GetDevice(), 1, &m_LastFrameFinished, VK_TRUE, std::numeric_limits<u64>::max());
-  vkResetFences(m_Device.GetDevice(), 1, &m_LastFrameFinished);
+void VKBackend::Draw(const Mat4 &cameraView, const Mat4 &projMatrix, const Mat4 &userData, const std::vector<Drawable> &scene, const std::vector<Drawable> &ui, const LightData& lights) {
+  //A replayed gaze trace drives the camera as well
+  Mat4 viewMatrix = cameraView;
+  GazeTrace::BeginFrame(viewMatrix);
+
+  //Wait for the GPU to finish the last frame that used this slot's resources
+  FrameResources &frame = m_Frames[m_FrameIndex];
+  vkWaitForFences(m_Device.GetDevice(), 1, &frame.m_Finished, VK_TRUE, std::numeric_limits<u64>::max());
+  vkResetFences(m_Device.GetDevice(), 1, &frame.m_Finished);
+  ReadPassTimes();
+
+  //Submit everything loaded since the last frame ahead of this frame's work, and recycle staging space from finished uploads
+  m_Uploader.Flush();
+  m_Uploader.Retire();
+
+  //Command buffers are re-recorded from scratch, so nothing is bound yet
+  m_BoundGeometry = {};
+  const u64 drawStartTime = SDL_GetPerformanceCounter();
   //Reset and begin command buffer
 
   VkClearValue clearColor = {lights.mDirectionalLight.m_AmbientColor.r,
@@ -861,21 +1325,34 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
   VkClearValue clearDepth = {1.0f, 0};
 
   //Overall foveated rendering control
-  static bool enableFoveatedRendering = true;
   ImGui::Begin("Foveated Rendering Settings");
 
-  bool newFoveatedRendering = enableFoveatedRendering;
+  bool newFoveatedRendering = m_EnableFoveatedRendering;
   if (ImGui::Checkbox("Enable Foveated Rendering", &newFoveatedRendering)) {
-    enableFoveatedRendering = newFoveatedRendering;
+    SetFoveationEnabled(newFoveatedRendering);
+  }
+  const bool enableFoveatedRendering = m_EnableFoveatedRendering;
+
+  bool adaptiveFoveation = m_FoveationController.IsEnabled();
+  if (ImGui::Checkbox("Adaptive Foveation", &adaptiveFoveation)) {
+    m_FoveationController.SetEnabled(adaptiveFoveation);
+  }
+
+  if (m_TimestampPool != VK_NULL_HANDLE) {
+    ImGui::Text("GPU Frame Time: %.2fms (Budget %.2fms)", m_GPUFrameTime / 1000.0f, m_FoveationController.GetBudget() / 1000.0f);
+    ImGui::Text("Shadow %.2fms, World %.2fms, Foveated %.2fms, UI %.2fms, Present %.2fms",
+                m_PassTimes[(int)TIMED_PASS::SHADOW] / 1000.0f, m_PassTimes[(int)TIMED_PASS::WORLD] / 1000.0f,
+                m_PassTimes[(int)TIMED_PASS::FOVEATED] / 1000.0f, m_PassTimes[(int)TIMED_PASS::UI] / 1000.0f,
+                m_PassTimes[(int)TIMED_PASS::PRESENT] / 1000.0f);
   }
   ImGui::End();
 
-  //Base pass resolution control
-  static float baseResScale = 1.0f;
+  //Foveated square size control
+  static u32 foveatedSize = 2 * MIN_FOVEATED_SIZE;
 
   if (enableFoveatedRendering) {
     ImGui::Begin("Base pass settings");
-    ImGui::Text("Base pass resolution %ux%u", m_WorldFB.GetWidth(), m_WorldFB.GetHeight());
+    ImGui::Text("Base pass resolution %ux%u", m_WorldExtent.width, m_WorldExtent.height);
     ImGui::Text("Base pass resolution scale:");
   }
 
@@ -903,11 +1380,7 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
 
   const float MIN_BASE_RES = 5.0;
   const float MAX_BASE_RES = 100.0;
-  float newBaseResScale = baseResScale * 100.0f;
-
-  if (!enableFoveatedRendering) {
-    baseResScale = 1.0f;
-  }
+  float newBaseResScale = m_BaseResScale * 100.0f;
 
   if (enableFoveatedRendering) {
     if (ImGui::SliderFloat("", &newBaseResScale, MIN_BASE_RES, MAX_BASE_RES, "%f%%")) {
@@ -925,35 +1398,56 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
     ImGui::End();
   }
 
+  //Adaptive foveation overrides the sliders to hold the frame time budget
+  //The frame after foveation was toggled reports the other mode's GPU time, so leave the controller alone for it
+  if (enableFoveatedRendering && m_FoveationController.IsEnabled() && !m_FoveationToggled) {
+    float controlledScale = newBaseResScale / 100.0f;
+    m_FoveationController.Update(m_GPUFrameTime, foveatedSize, controlledScale);
 
-  if (baseResScale != newBaseResScale / 100.0f) {
-    baseResScale = enableFoveatedRendering ? newBaseResScale / 100.0f : 1.0f;
+    if (std::abs(controlledScale * 100.0f - newBaseResScale) >= 0.5f) {
+      newBaseResScale = controlledScale * 100.0f;
+    }
+  }
 
-    m_WorldFB.Destroy(m_Device.GetDevice(), m_MemAllocator);
-    m_WorldFB.Setup(m_FoveatedFB.GetWidth() * baseResScale, m_FoveatedFB.GetHeight() * baseResScale, {m_Surface.GetDefaultFormat().format}, VK_FORMAT_D32_SFLOAT, false, m_Device.GetDevice(), m_MemAllocator);
-    VkDescriptorImageInfo worldFBInfo = m_WorldFB.GetColorImageInfos(m_TextureSampler)[0];
+  m_FoveationToggled = false;
 
-    VkWriteDescriptorSet worldFBWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
-    worldFBWrite.dstSet = m_WorldFBDescriptorSet;
-    worldFBWrite.dstBinding = 0;
-    worldFBWrite.dstArrayElement = 0;
-    worldFBWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    worldFBWrite.descriptorCount = 1;
-    worldFBWrite.pImageInfo = &worldFBInfo;
+  //Base pass resolution control, the chosen scale is kept while foveation is off
+  m_BaseResScale = newBaseResScale / 100.0f;
+  const float baseResScale = enableFoveatedRendering ? m_BaseResScale : 1.0f;
 
-    vkUpdateDescriptorSets(m_Device.GetDevice(), 1, &worldFBWrite, 0, nullptr);
-  }
+  //The world framebuffer stays at full size, the base pass only renders to the top left part of it
+  m_WorldExtent.width = std::max(1u, std::min(m_WorldFB.GetWidth(), (u32)(m_WorldFB.GetWidth() * baseResScale)));
+  m_WorldExtent.height = std::max(1u, std::min(m_WorldFB.GetHeight(), (u32)(m_WorldFB.GetHeight() * baseResScale)));
 
 
   //Setup camera information
   Mat4 vkProj = projMatrix;
   vkProj[1][1] *= -1;
   Mat4 matrices[] = { viewMatrix, vkProj };
-  void* data = mCameraUBO.Map(m_MemAllocator);
+  void* data = GetUBOSlice(mCameraUBO);
   memcpy(data, matrices, 2 * sizeof(Mat4));
 
+  //Only re-render the base pass every few frames, the frames in between reproject the last one to the current camera
+  bool renderBase = true;
+  if (m_ReprojectShader != nullptr && enableFoveatedRendering && m_BaseHistoryValid &&
+      m_BaseHistoryExtent.width == m_WorldExtent.width && m_BaseHistoryExtent.height == m_WorldExtent.height) {
+    renderBase = m_FramesSinceBaseRender + 1 >= m_PeripheryUpdateRate;
+  }
+
+  if (renderBase) {
+    m_FramesSinceBaseRender = 0;
+    m_BaseHistoryViewProj = vkProj * viewMatrix;
+    m_BaseHistoryExtent = m_WorldExtent;
+    m_BaseHistoryValid = true;
+  } else {
+    m_FramesSinceBaseRender++;
+    Mat4 reprojection = vkProj * viewMatrix * glm::inverse(m_BaseHistoryViewProj);
+    data = GetUBOSlice(mReprojectUBO);
+    memcpy(data, &reprojection, sizeof(Mat4));
+  }
+
   //Setup user data information
-  data = mUsrDataUBO.Map(m_MemAllocator);
+  data = GetUBOSlice(mUsrDataUBO);
   Mat4 modUserData = userData;
   modUserData[3] = Vec4(lights.mDirectionalLight.m_AmbientColor.r, lights.mDirectionalLight.m_AmbientColor.g, lights.mDirectionalLight.m_AmbientColor.b, 1.0f);
   memcpy(data, &modUserData, sizeof(Mat4));
@@ -972,91 +1466,183 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
   Mat4 lightView = glm::lookAt(dLightPosition, Vec3(0.0f, 0.0f, 0.0f), up);
   Mat4 lightProjection = glm::orthoZO(-20.0f, 20.0f, 20.0f, -20.0f, 1.0f, 100.0f);
   shadowedLightData.mDirectionalLight.m_LightSpaceMatrix = lightProjection * lightView;
-  data = mLightUBO.Map(m_MemAllocator);
-  memcpy(data, &shadowedLightData, sizeof(LightData));
+  shadowedLightData.mDirectionalLight.m_GazeShadowRect = Vec4(0.0f);
 
   VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-  //Create shadow maps
-  vkBeginCommandBuffer(m_ShadowCmdBuffer, &beginInfo);
+  //Sample the gaze point once per frame and predict where it will be once this frame is on screen
+  const u64 gazeSampleTime = SDL_GetPerformanceCounter();
+  GazePointManager::Update();
 
-  {
-    VkViewport shadowViewport = {};
-    shadowViewport.x = 0.0f;
-    shadowViewport.y = 0.0f;
-    shadowViewport.width = (float)(m_ShadowSize);
-    shadowViewport.height = (float)(m_ShadowSize);
-    shadowViewport.minDepth = 0.0f;
-    shadowViewport.maxDepth = 1.0f;
-    vkCmdSetViewport(m_ShadowCmdBuffer, 0, 1, &shadowViewport);
+  const float expectedLatency = m_CPULatency + m_GPUFrameTime + m_DisplayLatency;
+  GVec2 rawGazepoint = GazePointManager::GetGazePoint();
+  GVec2 gazepoint = GazePointManager::GetPredictedGazePoint(expectedLatency / 1000000.0f);
 
-    VkRect2D shadowScissor = {};
-    shadowScissor.offset = {0,0};
-    shadowScissor.extent = {m_ShadowSize, m_ShadowSize};
-    vkCmdSetScissor(m_ShadowCmdBuffer, 0, 1, &shadowScissor);
+  //Direction the eye looks along in view space, used to relax mesh detail in the periphery
+  Vec4 gazeView = glm::inverse(vkProj) * Vec4(2.0f * gazepoint.x - 1.0f, 2.0f * gazepoint.y - 1.0f, 0.5f, 1.0f);
+  if (gazeView.w != 0.0f && glm::length(Vec3(gazeView)) > 0.0f) {
+    m_GazeDirection = glm::normalize(Vec3(gazeView) / gazeView.w);
   }
 
-  VkRenderPassBeginInfo shadowBegin = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-  shadowBegin.renderPass = m_ShadowFB.GetRenderPass();
-  shadowBegin.framebuffer = m_ShadowFB.GetFramebuffer();
-  shadowBegin.renderArea.offset = {0,0};
-  shadowBegin.renderArea.extent = {m_ShadowSize, m_ShadowSize};
-  shadowBegin.clearValueCount = 1;
-  shadowBegin.pClearValues = &clearDepth;
+  //Fit a tight shadow cascade around what the user is looking at
+  Mat4 gazeLightSpace = Mat4(1.0f);
+  if (m_GazeShadowCascade) {
+    Vec3 focus = Vec3(lightView * Vec4(GetGazeFocusPoint(viewMatrix, scene), 1.0f));
+
+    //Snap to whole texels so the cascade doesn't shimmer as the gaze moves
+    const float texelSize = 2.0f * m_GazeShadowRadius / m_GazeShadowSize;
+    focus.x = std::floor(focus.x / texelSize) * texelSize;
+    focus.y = std::floor(focus.y / texelSize) * texelSize;
+
+    Mat4 gazeProjection = glm::orthoZO(focus.x - m_GazeShadowRadius, focus.x + m_GazeShadowRadius,
+                                       focus.y + m_GazeShadowRadius, focus.y - m_GazeShadowRadius, 1.0f, 100.0f);
+    gazeLightSpace = gazeProjection * lightView;
+
+    //The whole scene cascade sits right of the gaze one, crop its matrix into that rect so shaders that only know one cascade still read it
+    const float atlasWidth = (float)m_ShadowFB.GetWidth();
+    const float atlasHeight = (float)m_ShadowFB.GetHeight();
+    const Vec2 sceneScale = Vec2(m_ShadowSize / atlasWidth, m_ShadowSize / atlasHeight);
+    const float sceneOffset = m_GazeShadowSize / atlasWidth;
+    Mat4 crop = Mat4(1.0f);
+    crop[0][0] = sceneScale.x;
+    crop[1][1] = sceneScale.y;
+    crop[3][0] = sceneScale.x + 2.0f * sceneOffset - 1.0f;
+    crop[3][1] = sceneScale.y - 1.0f;
+    shadowedLightData.mDirectionalLight.m_LightSpaceMatrix = crop * lightProjection * lightView;
+    shadowedLightData.mDirectionalLight.m_GazeLightSpaceMatrix = gazeLightSpace;
+    shadowedLightData.mDirectionalLight.m_GazeShadowRect = Vec4(0.0f, 0.0f, m_GazeShadowSize / atlasWidth, m_GazeShadowSize / atlasHeight);
+  }
+  data = GetUBOSlice(mLightUBO);
+  memcpy(data, &shadowedLightData, sizeof(LightData));
 
-  vkCmdBeginRenderPass(m_ShadowCmdBuffer, &shadowBegin, VK_SUBPASS_CONTENTS_INLINE);
-  vkCmdBindPipeline(m_ShadowCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ShadowShader->m_Pipeline);
+  //Find the foveated square around the gaze point, in screen pixels
+  VkRect2D foveatedRect = GetGazeRect(gazepoint, foveatedSize);
+  Vec2 foveatedCenter = Vec2(gazepoint.x * m_UIFB.GetWidth(), gazepoint.y * m_UIFB.GetHeight());
+  float foveatedRadius = foveatedSize / 2.0f;
+
+  //When the eyes disagree, cover both of them so the dominant eye is always inside the sharp region
+  BinocularGaze eyes = GazePointManager::GetBinocularGaze();
+  if (m_BinocularFoveation && eyes.leftConfidence >= BINOCULAR_MIN_CONFIDENCE && eyes.rightConfidence >= BINOCULAR_MIN_CONFIDENCE) {
+    //Move both eyes along with the prediction of the combined point
+    GVec2 left = {eyes.left.x + gazepoint.x - rawGazepoint.x, eyes.left.y + gazepoint.y - rawGazepoint.y};
+    GVec2 right = {eyes.right.x + gazepoint.x - rawGazepoint.x, eyes.right.y + gazepoint.y - rawGazepoint.y};
+    VkRect2D leftRect = GetGazeRect(left, foveatedSize);
+    VkRect2D rightRect = GetGazeRect(right, foveatedSize);
+
+    int32_t minX = std::min(leftRect.offset.x, rightRect.offset.x);
+    int32_t minY = std::min(leftRect.offset.y, rightRect.offset.y);
+    int32_t maxX = std::max(leftRect.offset.x + (int32_t)leftRect.extent.width, rightRect.offset.x + (int32_t)rightRect.extent.width);
+    int32_t maxY = std::max(leftRect.offset.y + (int32_t)leftRect.extent.height, rightRect.offset.y + (int32_t)rightRect.extent.height);
+    foveatedRect.offset = {minX, minY};
+    foveatedRect.extent = {(u32)(maxX - minX), (u32)(maxY - minY)};
+
+    Vec2 leftCenter = Vec2(left.x * m_UIFB.GetWidth(), left.y * m_UIFB.GetHeight());
+    Vec2 rightCenter = Vec2(right.x * m_UIFB.GetWidth(), right.y * m_UIFB.GetHeight());
+    foveatedCenter = 0.5f * (leftCenter + rightCenter);
+
+    //Keep the blend inside the rectangle, which only grows along the direction the eyes differ in
+    foveatedRadius = std::min(foveatedRadius + 0.5f * glm::length(rightCenter - leftCenter),
+                              0.5f * std::min(foveatedRect.extent.width, foveatedRect.extent.height));
+  }
 
+  //In inset mode the rectangle has to fit in the smaller framebuffer
+  if (m_FoveatedInset) {
+    foveatedRect.extent.width = std::min(foveatedRect.extent.width, m_FoveatedFB.GetWidth());
+    foveatedRect.extent.height = std::min(foveatedRect.extent.height, m_FoveatedFB.GetHeight());
+  }
 
-  for (const auto& m : scene) {
-    VKVertexBuffer * vBuffer = static_cast<VKVertexBuffer*>(m.mVBuffer);
+  //Skip the foveated pass while a saccade is in flight, the eye can't make out the stale image
+  bool skipFoveated = false;
+  if (m_SaccadeSuppression && enableFoveatedRendering) {
+    //Convert the gaze velocity from screen units to degrees of view
+    GVec2 velocity = GazePointManager::GetGazeVelocity();
+    float fovX = glm::degrees(2.0f * std::atan(1.0f / projMatrix[0][0]));
+    float fovY = glm::degrees(2.0f * std::atan(1.0f / std::abs(projMatrix[1][1])));
+    m_GazeSpeed = glm::length(Vec2(velocity.x * fovX, velocity.y * fovY));
+
+    if (!m_InSaccade && m_GazeSpeed > m_SaccadeOnsetSpeed) {
+      m_InSaccade = true;
+    } else if (m_InSaccade && m_GazeSpeed < m_SaccadeOffsetSpeed) {
+      m_InSaccade = false;
+    }
 
-    if (m.mTexture == nullptr) {
-      vkCmdBindDescriptorSets(m_ShadowCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &m_DummyImage->m_TextureDescriptorSet, 0, nullptr);
+    //Still refresh the foveated image every so often in case the saccade detection is wrong
+    if (m_InSaccade && m_FoveatedHistoryValid && m_SkippedFoveatedFrames < m_MaxSkippedFrames) {
+      skipFoveated = true;
+      m_SkippedFoveatedFrames++;
     } else {
-      VKTexture* texture = static_cast<VKTexture*>(m.mTexture);
-      vkCmdBindDescriptorSets(m_ShadowCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &texture->m_TextureDescriptorSet, 0, nullptr);
+      m_SkippedFoveatedFrames = 0;
     }
-    Mat4 modelMatrix = lightProjection * lightView * m.mTransformMatrix;
+  }
 
-    vkCmdPushConstants(m_ShadowCmdBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Mat4), glm::value_ptr(modelMatrix));
+  //Where the foveated image gets composited, the last rendered one is reused while skipping
+  if (!skipFoveated) {
+    m_LastFoveatedRect = foveatedRect;
+    m_LastFoveatedCenter = foveatedCenter;
+    m_LastFoveatedRadius = foveatedRadius;
+  }
 
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(m_ShadowCmdBuffer, 0, 1, &vBuffer->m_Buffer, offsets);
-    vkCmdBindIndexBuffer(m_ShadowCmdBuffer, vBuffer->m_Buffer, vBuffer->m_IndexOffset, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed(m_ShadowCmdBuffer, m.mNumFaces * 3, 1, 0, 0, 0);
+  //Create shadow maps
+  vkBeginCommandBuffer(frame.m_ShadowCmdBuffer, &beginInfo);
+
+  //Shadow pass is submitted first, so reset the timestamps here
+  if (m_TimestampPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(frame.m_ShadowCmdBuffer, m_TimestampPool, GetTimestampQuery(m_TimestampFrame, TIMED_PASS::SHADOW), 2 * (u32)TIMED_PASS::COUNT);
   }
+  BeginPassTimer(frame.m_ShadowCmdBuffer, TIMED_PASS::SHADOW);
 
-  vkCmdEndRenderPass(m_ShadowCmdBuffer);
-  vkEndCommandBuffer(m_ShadowCmdBuffer);
+  VkRenderPassBeginInfo shadowBegin = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+  shadowBegin.renderPass = m_ShadowFB.GetRenderPass();
+  shadowBegin.framebuffer = m_ShadowFB.GetFramebuffer();
+  shadowBegin.renderArea.offset = {0,0};
+  shadowBegin.renderArea.extent = {m_ShadowFB.GetWidth(), m_ShadowFB.GetHeight()};
+  shadowBegin.clearValueCount = 1;
+  shadowBegin.pClearValues = &clearDepth;
+
+  vkCmdBeginRenderPass(frame.m_ShadowCmdBuffer, &shadowBegin, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindPipeline(frame.m_ShadowCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ShadowShader->m_Pipeline);
+
+  if (m_GazeShadowCascade) {
+    //The gaze cascade only needs the casters inside its small box
+    DrawShadowCasters(frame.m_ShadowCmdBuffer, scene, gazeLightSpace, {{0, 0}, {m_GazeShadowSize, m_GazeShadowSize}}, true);
+    DrawShadowCasters(frame.m_ShadowCmdBuffer, scene, lightProjection * lightView, {{(int32_t)m_GazeShadowSize, 0}, {m_ShadowSize, m_ShadowSize}}, false);
+  } else {
+    DrawShadowCasters(frame.m_ShadowCmdBuffer, scene, lightProjection * lightView, {{0, 0}, {m_ShadowSize, m_ShadowSize}}, false);
+  }
+
+  vkCmdEndRenderPass(frame.m_ShadowCmdBuffer);
+  EndPassTimer(frame.m_ShadowCmdBuffer, TIMED_PASS::SHADOW);
+  vkEndCommandBuffer(frame.m_ShadowCmdBuffer);
 
   VkSemaphore shadowSemaphore = m_ShadowFB.GetSemaphore();
-  VkSemaphore shadowSignalSemaphores[] = {m_ShadowFB.GetSemaphore(), m_ShadowToFoveated};
+  VkSemaphore shadowSignalSemaphores[] = {m_ShadowFB.GetSemaphore(), frame.m_ShadowToFoveated};
   VkSubmitInfo shadowSubmit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
   shadowSubmit.commandBufferCount = 1;
-  shadowSubmit.pCommandBuffers = &m_ShadowCmdBuffer;
-  shadowSubmit.signalSemaphoreCount = 2;
+  shadowSubmit.pCommandBuffers = &frame.m_ShadowCmdBuffer;
+  //The foveated pass waits on the shadow map too, unless it is skipped this frame
+  shadowSubmit.signalSemaphoreCount = skipFoveated ? 1 : 2;
   shadowSubmit.pSignalSemaphores = shadowSignalSemaphores;
 
   vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &shadowSubmit, VK_NULL_HANDLE);
 
-  vkBeginCommandBuffer(m_WorldCmdBuffer, &beginInfo);
+  vkBeginCommandBuffer(frame.m_WorldCmdBuffer, &beginInfo);
+  BeginPassTimer(frame.m_WorldCmdBuffer, TIMED_PASS::WORLD);
 
   {
     VkViewport viewport = {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = (float)(m_WorldFB.GetWidth());
-    viewport.height = (float)(m_WorldFB.GetHeight());
+    viewport.width = (float)(m_WorldExtent.width);
+    viewport.height = (float)(m_WorldExtent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(m_WorldCmdBuffer, 0, 1, &viewport);
+    vkCmdSetViewport(frame.m_WorldCmdBuffer, 0, 1, &viewport);
 
     VkRect2D scissor = {};
     scissor.offset = {0,0};
-    scissor.extent = {m_WorldFB.GetWidth(), m_WorldFB.GetHeight()};
-    vkCmdSetScissor(m_WorldCmdBuffer, 0, 1, &scissor);
+    scissor.extent = m_WorldExtent;
+    vkCmdSetScissor(frame.m_WorldCmdBuffer, 0, 1, &scissor);
   }
 
   //Startup 1st renderpass for 3D world
@@ -1065,23 +1651,41 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
   worldBeginInfo.framebuffer = m_WorldFB.GetFramebuffer();
 
   worldBeginInfo.renderArea.offset = {0,0};
-  worldBeginInfo.renderArea.extent = { m_WorldFB.GetWidth(), m_WorldFB.GetHeight() };
+  worldBeginInfo.renderArea.extent = m_WorldExtent;
 
   VkClearValue clears[] = {clearColor, clearDepth};
   worldBeginInfo.clearValueCount = 2;
   worldBeginInfo.pClearValues = clears;
 
-  vkCmdBeginRenderPass(m_WorldCmdBuffer, &worldBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-  vkCmdBindDescriptorSets(m_WorldCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_PerFrameDescriptorSet, 0, nullptr);
+  if (renderBase) {
+    vkCmdBeginRenderPass(frame.m_WorldCmdBuffer, &worldBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindDescriptorSets(frame.m_WorldCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &frame.m_PerFrameDescriptorSet, 0, nullptr);
 
-  //Draw objects
-  for(const auto &model : scene) {
-    DrawModel(model, m_WorldCmdBuffer);
+    //Draw objects, the fovea is redrawn on top so the base pass can use the cheaper peripheral shaders
+    for(const auto &model : scene) {
+      u32 lod = SelectLOD(model, viewMatrix, vkProj, m_WorldExtent.height, enableFoveatedRendering);
+      DrawModel(model, frame.m_WorldCmdBuffer, enableFoveatedRendering, lod);
+    }
+
+    vkCmdEndRenderPass(frame.m_WorldCmdBuffer);
   }
 
-  //End renderpass and setup sync with next pass
-  vkCmdEndRenderPass(m_WorldCmdBuffer);
-  vkEndCommandBuffer(m_WorldCmdBuffer);
+  //Draw the foveation layers into the same command buffer, they are composited along with the base pass
+  if (enableFoveatedRendering) {
+    for (auto &layer : m_FoveationLayers) {
+      DrawFoveationLayer(layer, gazepoint, viewMatrix, vkProj, scene, frame.m_WorldCmdBuffer);
+    }
+  }
+
+  //End command buffer and setup sync with next pass
+  EndPassTimer(frame.m_WorldCmdBuffer, TIMED_PASS::WORLD);
+
+  //Keep the foveated timestamps valid when the pass is skipped
+  if (skipFoveated) {
+    BeginPassTimer(frame.m_WorldCmdBuffer, TIMED_PASS::FOVEATED);
+    EndPassTimer(frame.m_WorldCmdBuffer, TIMED_PASS::FOVEATED);
+  }
+  vkEndCommandBuffer(frame.m_WorldCmdBuffer);
 
   VkSemaphore worldSemaphore[] = {m_WorldFB.GetSemaphore()};
 
@@ -1093,85 +1697,63 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
   worldSubmit.signalSemaphoreCount = 1;
   worldSubmit.pSignalSemaphores = worldSemaphore;
   worldSubmit.commandBufferCount = 1;
-  worldSubmit.pCommandBuffers = &m_WorldCmdBuffer;
+  worldSubmit.pCommandBuffers = &frame.m_WorldCmdBuffer;
   vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &worldSubmit, VK_NULL_HANDLE);
 
-  //Draw same scene in foveated command buffer
-  {
-    vkBeginCommandBuffer(m_FoveatedCmdBuffer, &beginInfo);
-
-    {
-      VkViewport viewport = {};
-      viewport.x = 0.0f;
-      viewport.y = 0.0f;
-      viewport.width = (float)(m_FoveatedFB.GetWidth());
-      viewport.height = (float)(m_FoveatedFB.GetHeight());
-      viewport.minDepth = 0.0f;
-      viewport.maxDepth = 1.0f;
-      vkCmdSetViewport(m_FoveatedCmdBuffer, 0, 1, &viewport);
-
-      GVec2 gazepoint = GazePointManager::GetGazePoint();
+  //Meshes that can be seen through the foveated square
+  std::vector<const Drawable*> fovealScene;
 
-      const u32 MAX_FOVEATED_SIZE = 2400;
-      const u32 MIN_FOVEATED_SIZE = 120;
-
-      static u32 foveatedSize = 2 * MIN_FOVEATED_SIZE;
-
-      u32 pixelX = gazepoint.x * m_FoveatedFB.GetWidth();
-      u32 pixelY = gazepoint.y * m_FoveatedFB.GetHeight();
-
-      int topleftX = pixelX - (foveatedSize / 2);
-      int topleftY = pixelY - (foveatedSize / 2);
+  //Draw same scene in foveated command buffer
+  if (!skipFoveated) {
+    //Projection for the foveated pass, narrowed to the foveated square when rendering an inset
+    Mat4 fovProj = vkProj;
 
-      int bottomRightX = topleftX + foveatedSize;
-      int bottomRightY = topleftY + foveatedSize;
+    if (foveatedRect.extent.width > 0 && foveatedRect.extent.height > 0) {
+      Mat4 subProj = GetRectProjection(vkProj, foveatedRect);
 
-      //Clamp rectangle to window boundaries
-      if (topleftX < 0) {
-        topleftX = 0;
+      if (m_FoveatedInset) {
+        fovProj = subProj;
       }
 
-      if (topleftY < 0) {
-        topleftY = 0;
-      }
+      //Cull the scene against the part of the view frustum behind the foveated square
+      Frustum fovealFrustum;
+      fovealFrustum.Setup(subProj * viewMatrix);
 
-      if (bottomRightX > m_FoveatedFB.GetWidth()) {
-        bottomRightX = m_FoveatedFB.GetWidth();
-      }
+      for (const auto &model : scene) {
+        Vec3 center = model.mBoundsCenter;
+        float radius = model.mBoundsRadius;
+        TransformSphere(model.mTransformMatrix, center, radius);
 
-      if (bottomRightY > m_FoveatedFB.GetHeight()) {
-        bottomRightY = m_FoveatedFB.GetHeight();
+        if (fovealFrustum.IntersectsSphere(center, radius)) {
+          fovealScene.push_back(&model);
+        }
       }
+    }
 
-      VkRect2D scissor = {};
-      scissor.offset.x = topleftX;
-      scissor.offset.y = topleftY;
-      scissor.extent = {(u32)(bottomRightX - topleftX), (u32)(bottomRightY - topleftY)};
-      vkCmdSetScissor(m_FoveatedCmdBuffer, 0, 1, &scissor);
-
-      //Do any backend related ImGUI stuff
-      if (enableFoveatedRendering) {
-        ImGui::Begin("Foveated Square Settings");
-
-        int newSize = foveatedSize;
+    Mat4 fovMatrices[] = { viewMatrix, fovProj };
+    data = GetUBOSlice(mFoveatedCameraUBO);
+    memcpy(data, fovMatrices, 2 * sizeof(Mat4));
 
-        ImGui::Text("Gaze Coordinates { %f, %f }", gazepoint.x, gazepoint.y);
-        ImGui::Text("Foveated Square Size:");
-        if (ImGui::SliderInt("", &newSize, MIN_FOVEATED_SIZE, MAX_FOVEATED_SIZE, "%dpx")) {
-          //Clamp the new size before storing it
-          if (newSize < MIN_FOVEATED_SIZE) {
-            newSize = MIN_FOVEATED_SIZE;
-          }
+    //An inset is rendered into the top left corner of the foveated framebuffer
+    VkRect2D fovTarget = foveatedRect;
+    if (m_FoveatedInset) {
+      fovTarget.offset = {0,0};
+    }
 
-          if (newSize > MAX_FOVEATED_SIZE) {
-            newSize = MAX_FOVEATED_SIZE;
-          }
+    vkBeginCommandBuffer(frame.m_FoveatedCmdBuffer, &beginInfo);
+    BeginPassTimer(frame.m_FoveatedCmdBuffer, TIMED_PASS::FOVEATED);
 
-          foveatedSize = newSize;
-        }
+    {
+      VkViewport viewport = {};
+      viewport.x = 0.0f;
+      viewport.y = 0.0f;
+      viewport.width = m_FoveatedInset ? (float)(fovTarget.extent.width) : (float)(m_FoveatedFB.GetWidth());
+      viewport.height = m_FoveatedInset ? (float)(fovTarget.extent.height) : (float)(m_FoveatedFB.GetHeight());
+      viewport.minDepth = 0.0f;
+      viewport.maxDepth = 1.0f;
+      vkCmdSetViewport(frame.m_FoveatedCmdBuffer, 0, 1, &viewport);
 
-        ImGui::End();
-      }
+      vkCmdSetScissor(frame.m_FoveatedCmdBuffer, 0, 1, &fovTarget);
     }
 
     VkClearValue fovClear = {lights.mDirectionalLight.m_AmbientColor.r,
@@ -1183,45 +1765,117 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
     VkRenderPassBeginInfo fovRenderPass = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
     fovRenderPass.renderPass = m_FoveatedFB.GetRenderPass();
     fovRenderPass.framebuffer = m_FoveatedFB.GetFramebuffer();
-    fovRenderPass.renderArea.offset = {0,0};
-    fovRenderPass.renderArea.extent = {m_FoveatedFB.GetWidth(), m_FoveatedFB.GetHeight()};
+    if (m_FoveatedInset) {
+      //Only the inset needs clearing, the rest of the framebuffer is never sampled
+      fovRenderPass.renderArea = fovTarget;
+    } else {
+      fovRenderPass.renderArea.offset = {0,0};
+      fovRenderPass.renderArea.extent = {m_FoveatedFB.GetWidth(), m_FoveatedFB.GetHeight()};
+    }
     fovRenderPass.clearValueCount = 2;
     fovRenderPass.pClearValues = fovClears;
 
-    vkCmdBeginRenderPass(m_FoveatedCmdBuffer, &fovRenderPass, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(frame.m_FoveatedCmdBuffer, &fovRenderPass, VK_SUBPASS_CONTENTS_INLINE);
 
-    vkCmdBindDescriptorSets(m_FoveatedCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_PerFrameDescriptorSet, 0, nullptr);
+    vkCmdBindDescriptorSets(frame.m_FoveatedCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &frame.m_FoveatedPerFrameDescriptorSet, 0, nullptr);
 
     if (enableFoveatedRendering) {
-      DrawFrameBuffer(m_FoveatedCmdBuffer, m_FoveatedClearShader->m_Pipeline, m_DummyImage->m_TextureDescriptorSet);
+      DrawFrameBuffer(frame.m_FoveatedCmdBuffer, m_FoveatedClearShader->m_Pipeline, m_DummyImage->m_TextureDescriptorSet);
 
       //Draw objects
-      for(const auto &model : scene) {
-        DrawModel(model, m_FoveatedCmdBuffer);
+      //The fovea is at full resolution, only distance reduces its detail
+      for(const auto model : fovealScene) {
+        DrawModel(*model, frame.m_FoveatedCmdBuffer, false, SelectLOD(*model, viewMatrix, vkProj, m_UIFB.GetHeight(), false));
       }
     }
 
 
     //End renderpass and setup sync with next pass
-    vkCmdEndRenderPass(m_FoveatedCmdBuffer);
-    vkEndCommandBuffer(m_FoveatedCmdBuffer);
+    vkCmdEndRenderPass(frame.m_FoveatedCmdBuffer);
+    EndPassTimer(frame.m_FoveatedCmdBuffer, TIMED_PASS::FOVEATED);
+    vkEndCommandBuffer(frame.m_FoveatedCmdBuffer);
 
     VkSemaphore semaphore[] = {m_FoveatedFB.GetSemaphore()};
 
     VkSubmitInfo submit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
     VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     submit.waitSemaphoreCount = 1;
-    submit.pWaitSemaphores = &m_ShadowToFoveated;
+    submit.pWaitSemaphores = &frame.m_ShadowToFoveated;
     submit.pWaitDstStageMask = &waitStages;
     submit.signalSemaphoreCount = 1;
     submit.pSignalSemaphores = semaphore;
     submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &m_FoveatedCmdBuffer;
+    submit.pCommandBuffers = &frame.m_FoveatedCmdBuffer;
     vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &submit, VK_NULL_HANDLE);
+
+    m_FoveatedHistoryValid = enableFoveatedRendering;
+  }
+
+  //Do any backend related ImGUI stuff
+  if (enableFoveatedRendering) {
+    ImGui::Begin("Foveated Square Settings");
+
+    int newSize = foveatedSize;
+
+    ImGui::Text("Gaze Coordinates { %f, %f }", rawGazepoint.x, rawGazepoint.y);
+    if (GazeTrace::IsReplaying()) {
+      ImGui::Text("Replaying Gaze Trace: frame %u", GazeTrace::GetFrameIndex());
+    } else if (GazeTrace::IsRecording()) {
+      ImGui::Text("Recording Gaze Trace: frame %u", GazeTrace::GetFrameIndex());
+    }
+    if (m_BinocularFoveation) {
+      ImGui::Text("Left Eye { %f, %f } %.2f", eyes.left.x, eyes.left.y, eyes.leftConfidence);
+      ImGui::Text("Right Eye { %f, %f } %.2f", eyes.right.x, eyes.right.y, eyes.rightConfidence);
+    }
+
+    const char* predictionModes[] = { "None", "Linear", "Constant Acceleration" };
+    int prediction = (int)GazePointManager::GetPrediction();
+    if (ImGui::Combo("Gaze Prediction", &prediction, predictionModes, 3)) {
+      GazePointManager::SetPrediction((GAZE_PREDICTION)prediction);
+    }
+
+    if (GazePointManager::GetPrediction() != GAZE_PREDICTION::NONE) {
+      ImGui::Text("Predicted Coordinates { %f, %f }", gazepoint.x, gazepoint.y);
+      ImGui::Text("Expected Latency: %.2fms", expectedLatency / 1000.0f);
+    }
+    if (skipFoveated) {
+      ImGui::Text("Foveated Meshes: skipped during saccade");
+    } else {
+      ImGui::Text("Foveated Meshes: %u / %u", (u32)fovealScene.size(), (u32)scene.size());
+    }
+
+    if (m_ReprojectShader != nullptr) {
+      ImGui::Text("Base Pass: %s", renderBase ? "rendered" : "reprojected");
+    }
+
+    if (m_SaccadeSuppression) {
+      ImGui::Text("Gaze Speed: %.0f deg/s%s", m_GazeSpeed, m_InSaccade ? " (saccade)" : "");
+    }
+    ImGui::Text("Foveated Square Size:");
+    if (ImGui::SliderInt("", &newSize, MIN_FOVEATED_SIZE, MAX_FOVEATED_SIZE, "%dpx")) {
+      //Clamp the new size before storing it
+      if (newSize < MIN_FOVEATED_SIZE) {
+        newSize = MIN_FOVEATED_SIZE;
+      }
+
+      if (newSize > MAX_FOVEATED_SIZE) {
+        newSize = MAX_FOVEATED_SIZE;
+      }
+
+      foveatedSize = newSize;
+    }
+
+    if (m_CompositeShader != nullptr) {
+      ImGui::Text("Layer Blend Width:");
+      ImGui::SliderFloat("##blendwidth", &m_BlendWidth, 1.0f, MAX_FOVEATED_SIZE / 2.0f, "%.0fpx");
+    }
+
+    ImGui::End();
   }
 
   //Startup 2nd renderpass for UI
-  vkBeginCommandBuffer(m_UICmdBuffer, &beginInfo);
+  vkBeginCommandBuffer(frame.m_UICmdBuffer, &beginInfo);
+  BeginPassTimer(frame.m_UICmdBuffer, TIMED_PASS::UI);
 
   {
     VkViewport viewport = {};
@@ -1231,12 +1885,12 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
     viewport.height = (float)(m_UIFB.GetHeight());
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(m_UICmdBuffer, 0, 1, &viewport);
+    vkCmdSetViewport(frame.m_UICmdBuffer, 0, 1, &viewport);
 
     VkRect2D scissor = {};
     scissor.offset = {0,0};
     scissor.extent = {m_UIFB.GetWidth(), m_UIFB.GetHeight()};
-    vkCmdSetScissor(m_UICmdBuffer, 0, 1, &scissor);
+    vkCmdSetScissor(frame.m_UICmdBuffer, 0, 1, &scissor);
   }
 
   VkRenderPassBeginInfo uiBeginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
@@ -1247,28 +1901,81 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
   uiBeginInfo.clearValueCount = 2;
   uiBeginInfo.pClearValues = clears;
 
-  vkCmdBeginRenderPass(m_UICmdBuffer, &uiBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-  vkCmdBindDescriptorSets(m_UICmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_PerFrameDescriptorSet, 0, nullptr);
+  vkCmdBeginRenderPass(frame.m_UICmdBuffer, &uiBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindDescriptorSets(frame.m_UICmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &frame.m_PerFrameDescriptorSet, 0, nullptr);
 
-  //Draw framebuffer
-  DrawFrameBuffer(m_UICmdBuffer, m_UIFBShader->m_Pipeline, m_WorldFBDescriptorSet);
-  DrawFrameBuffer(m_UICmdBuffer, m_UIFBShader->m_Pipeline, m_FoveatedDescriptorSet);
+  //Draw framebuffer, stretching the part the base pass rendered to over the whole screen
+  VkRect2D screenRect = {};
+  screenRect.offset = {0,0};
+  screenRect.extent = {m_UIFB.GetWidth(), m_UIFB.GetHeight()};
+
+  SetInsetViewport(frame.m_UICmdBuffer, m_WorldFB.GetWidth(), m_WorldFB.GetHeight(), screenRect, m_WorldExtent);
+  const Vec2 worldUVScale = Vec2((float)m_WorldExtent.width / m_WorldFB.GetWidth(), (float)m_WorldExtent.height / m_WorldFB.GetHeight());
+  const bool upsampleBase = m_UpsampleShader != nullptr && (m_WorldExtent.width != m_WorldFB.GetWidth() || m_WorldExtent.height != m_WorldFB.GetHeight());
+  if (renderBase && !upsampleBase) {
+    DrawFrameBuffer(frame.m_UICmdBuffer, m_UIFBShader->m_Pipeline, m_WorldFBDescriptorSet);
+  } else {
+    //Both paths read the base pass depth, reprojected frames use plain filtering
+    Vec4 baseData = Vec4(worldUVScale.x, worldUVScale.y, vkProj[2][2], m_UpsampleSensitivity);
+    VKShader* baseShader = renderBase ? m_UpsampleShader : m_ReprojectShader;
+
+    vkCmdBindDescriptorSets(frame.m_UICmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &frame.m_WorldDepthDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(frame.m_UICmdBuffer, m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(Mat4), sizeof(Vec4), glm::value_ptr(baseData));
+    DrawFrameBuffer(frame.m_UICmdBuffer, baseShader->m_Pipeline, m_WorldFBDescriptorSet);
+    vkCmdBindDescriptorSets(frame.m_UICmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &frame.m_PerFrameDescriptorSet, 0, nullptr);
+  }
+  SetInsetViewport(frame.m_UICmdBuffer, m_UIFB.GetWidth(), m_UIFB.GetHeight(), screenRect, screenRect.extent);
+
+  //Draw the foveation layers from the outside in, followed by the foveated square
+  Vec2 gazePixel = Vec2(gazepoint.x * m_UIFB.GetWidth(), gazepoint.y * m_UIFB.GetHeight());
+  const VkRect2D fovCompositeRect = m_LastFoveatedRect;
+  bool insetDrawn = false;
+  if (enableFoveatedRendering) {
+    for (auto &layer : m_FoveationLayers) {
+      if (layer.m_RenderExtent.width > 0 && layer.m_RenderExtent.height > 0) {
+        DrawInset(frame.m_UICmdBuffer, layer.m_FBDescriptorSet, layer.m_FB.GetWidth(), layer.m_FB.GetHeight(), layer.m_Rect, layer.m_RenderExtent, gazePixel, layer.m_Size / 2.0f);
+        insetDrawn = true;
+      }
+    }
+  }
+
+  if (m_FoveatedInset) {
+    if (fovCompositeRect.extent.width > 0 && fovCompositeRect.extent.height > 0) {
+      DrawInset(frame.m_UICmdBuffer, m_FoveatedDescriptorSet, m_FoveatedFB.GetWidth(), m_FoveatedFB.GetHeight(), fovCompositeRect, fovCompositeRect.extent, m_LastFoveatedCenter, m_LastFoveatedRadius);
+      insetDrawn = true;
+    }
+  } else {
+    DrawComposite(frame.m_UICmdBuffer, m_FoveatedDescriptorSet, m_LastFoveatedCenter, m_LastFoveatedRadius);
+  }
+
+  //Restore the full screen viewport for the UI
+  if (insetDrawn) {
+    SetInsetViewport(frame.m_UICmdBuffer, m_UIFB.GetWidth(), m_UIFB.GetHeight(), screenRect, screenRect.extent);
+  }
 
   //Draw objects
   for(const auto &model : ui) {
-    DrawModel(model, m_UICmdBuffer);
+    DrawModel(model, frame.m_UICmdBuffer);
   }
 
   //Startup 3rd renderpass for aspect correction
-  vkCmdEndRenderPass(m_UICmdBuffer);
-  vkEndCommandBuffer(m_UICmdBuffer);
+  vkCmdEndRenderPass(frame.m_UICmdBuffer);
+  EndPassTimer(frame.m_UICmdBuffer, TIMED_PASS::UI);
+  if (m_CaptureRequested) {
+    RecordFrameCapture(frame.m_UICmdBuffer);
+    m_CaptureGaze = m_LastFoveatedCenter;
+    m_CaptureFrameIndex = m_FrameIndex;
+    m_CaptureRequested = false;
+    m_CaptureWritten = true;
+  }
+  vkEndCommandBuffer(frame.m_UICmdBuffer);
 
   VkSemaphore uiWaitSemaphores[] = {m_WorldFB.GetSemaphore(), m_FoveatedFB.GetSemaphore()};
 
   VkSubmitInfo uiSubmit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
   uiSubmit.commandBufferCount = 1;
-  uiSubmit.pCommandBuffers = &m_UICmdBuffer;
-  uiSubmit.waitSemaphoreCount = 2;
+  uiSubmit.pCommandBuffers = &frame.m_UICmdBuffer;
+  uiSubmit.waitSemaphoreCount = skipFoveated ? 1 : 2;
   uiSubmit.pWaitSemaphores = uiWaitSemaphores;
 
   VkSemaphore uiSemaphore[] = {m_UIFB.GetSemaphore()};
@@ -1279,9 +1986,14 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
 
   vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &uiSubmit, VK_NULL_HANDLE);
 
-  u32 imgIndex;
-  vkAcquireNextImageKHR(m_Device.GetDevice(), m_Surface.GetSwapchain(), std::numeric_limits<u64>::max(), m_ImageAvailable, VK_NULL_HANDLE, &imgIndex);
-  vkBeginCommandBuffer(m_PresentCmdBuffer, &beginInfo);
+  //Headless frames have no presentation engine handing out images, so just take turns
+  if (m_Surface.IsHeadless()) {
+    m_ImageIndex = (m_ImageIndex + 1) % m_Surface.GetSwapchainImageCount();
+  } else {
+    vkAcquireNextImageKHR(m_Device.GetDevice(), m_Surface.GetSwapchain(), std::numeric_limits<u64>::max(), frame.m_ImageAvailable, VK_NULL_HANDLE, &m_ImageIndex);
+  }
+  vkBeginCommandBuffer(frame.m_PresentCmdBuffer, &beginInfo);
+  BeginPassTimer(frame.m_PresentCmdBuffer, TIMED_PASS::PRESENT);
 
   {
     VkViewport viewport = {};
@@ -1291,93 +2003,417 @@ void VKBackend::Draw(const Mat4 &viewMatrix, const Mat4 &projMatrix, const Mat4
     viewport.height = (float)(m_Surface.GetSwapchainExtent().height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(m_PresentCmdBuffer, 0, 1, &viewport);
+    vkCmdSetViewport(frame.m_PresentCmdBuffer, 0, 1, &viewport);
 
     VkRect2D scissor = {};
     scissor.offset = {0,0};
     scissor.extent = m_Surface.GetSwapchainExtent();
-    vkCmdSetScissor(m_PresentCmdBuffer, 0, 1, &scissor);
+    vkCmdSetScissor(frame.m_PresentCmdBuffer, 0, 1, &scissor);
   }
 
   VkRenderPassBeginInfo aspectBegin = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
   aspectBegin.renderPass = m_Surface.GetRenderPass();
-  aspectBegin.framebuffer = m_Surface.GetFramebuffer(imgIndex);
+  aspectBegin.framebuffer = m_Surface.GetFramebuffer(m_ImageIndex);
   aspectBegin.renderArea.offset = { 0,0 };
   aspectBegin.renderArea.extent = m_Surface.GetSwapchainExtent();
   aspectBegin.clearValueCount = 1;
   aspectBegin.pClearValues = &clearColor;
 
-  vkCmdBeginRenderPass(m_PresentCmdBuffer, &aspectBegin, VK_SUBPASS_CONTENTS_INLINE);
-  vkCmdBindDescriptorSets(m_PresentCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_PerFrameDescriptorSet, 0, nullptr);
+  vkCmdBeginRenderPass(frame.m_PresentCmdBuffer, &aspectBegin, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindDescriptorSets(frame.m_PresentCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &frame.m_PerFrameDescriptorSet, 0, nullptr);
   
   //Draw FB image
-  DrawFrameBuffer(m_PresentCmdBuffer, m_AspectShader->m_Pipeline, m_UIFBDescriptorSet);
+  DrawFrameBuffer(frame.m_PresentCmdBuffer, m_AspectShader->m_Pipeline, m_UIFBDescriptorSet);
 
   //Render ImGui data
   ImGui::Render();
-  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_PresentCmdBuffer);
+  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frame.m_PresentCmdBuffer);
+  m_BoundGeometry = {};
 
   //Finish command buffer
-  vkCmdEndRenderPass(m_PresentCmdBuffer);
-  vkEndCommandBuffer(m_PresentCmdBuffer);
+  vkCmdEndRenderPass(frame.m_PresentCmdBuffer);
+  EndPassTimer(frame.m_PresentCmdBuffer, TIMED_PASS::PRESENT);
+  vkEndCommandBuffer(frame.m_PresentCmdBuffer);
 
   //Setup semaphore for syncing with presentation
   VkSubmitInfo aspectSubmit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
   aspectSubmit.commandBufferCount = 1;
-  aspectSubmit.pCommandBuffers = &m_PresentCmdBuffer;
-  aspectSubmit.waitSemaphoreCount = 2;
+  aspectSubmit.pCommandBuffers = &frame.m_PresentCmdBuffer;
+  aspectSubmit.waitSemaphoreCount = m_Surface.IsHeadless() ? 1 : 2;
 
-  VkSemaphore aspectWaitSemaphores[] = { m_UIFB.GetSemaphore(), m_ImageAvailable };
+  VkSemaphore aspectWaitSemaphores[] = { m_UIFB.GetSemaphore(), frame.m_ImageAvailable };
   aspectSubmit.pWaitSemaphores = aspectWaitSemaphores;
 
   VkPipelineStageFlags aspectWaitStages[] = { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
   aspectSubmit.pWaitDstStageMask = aspectWaitStages;
-  aspectSubmit.signalSemaphoreCount = 1;
-  aspectSubmit.pSignalSemaphores = &m_RenderFinished;
+  aspectSubmit.signalSemaphoreCount = m_Surface.IsHeadless() ? 0 : 1;
+  aspectSubmit.pSignalSemaphores = &frame.m_RenderFinished;
 
   //Submit commands
-  vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &aspectSubmit, m_LastFrameFinished);
+  vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &aspectSubmit, frame.m_Finished);
+  if (m_TimestampPool != VK_NULL_HANDLE) {
+    m_TimestampFrame++;
+  }
+  m_FrameIndex = (m_FrameIndex + 1) % m_FramesInFlight;
+
+  //CPU side of the gaze to photon latency, used for predicting the next frame's gaze point
+  m_CPULatency = (float)((SDL_GetPerformanceCounter() - gazeSampleTime) * 1000000.0 / SDL_GetPerformanceFrequency());
+  m_CPUDrawTime = (float)((SDL_GetPerformanceCounter() - drawStartTime) * 1000000.0 / SDL_GetPerformanceFrequency());
+
+  if (m_Surface.IsHeadless()) {
+    return;
+  }
 
   //Setup present
   VkSwapchainKHR swapchains[] = { m_Surface.GetSwapchain() };
   VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = &m_RenderFinished;
+  presentInfo.pWaitSemaphores = &frame.m_RenderFinished;
   presentInfo.swapchainCount = 1;
   presentInfo.pSwapchains = swapchains;
-  presentInfo.pImageIndices = &imgIndex;
+  presentInfo.pImageIndices = &m_ImageIndex;
   //Submit presentation to queue
   vkQueuePresentKHR(m_Device.GetPresentQueue(), &presentInfo);
 }
 
-void VKBackend::DrawModel(const Drawable &d, VkCommandBuffer cmdBfr) {
-  VKShader* shader = static_cast<VKShader*>(d.mShader);
+void* VKBackend::GetUBOSlice(VKBuffer &ubo) {
+  return (u8*)ubo.Map(m_MemAllocator) + m_FrameIndex * m_UBOSliceSize;
+}
+
+void VKBackend::DrawModel(const Drawable &d, VkCommandBuffer cmdBfr, const bool peripheral, const u32 lod) {
+  VKShader* shader = static_cast<VKShader*>((peripheral && d.mPeripheralShader != nullptr) ? d.mPeripheralShader : d.mShader);
+
+  //Shaders still building on a worker fall back to the other shader of the pair, or skip the draw until one is ready
+  if (!shader->m_Ready) {
+    VKShader* fallback = static_cast<VKShader*>(shader == d.mShader ? d.mPeripheralShader : d.mShader);
+    if (fallback == nullptr || !fallback->m_Ready) {
+      return;
+    }
+    shader = fallback;
+  }
   VKVertexBuffer* vBuffer = static_cast<VKVertexBuffer*>(d.mVBuffer);
   VKTexture* texture = static_cast<VKTexture*>(d.mTexture);
 
   vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, shader->m_Pipeline);
 
   if (texture != nullptr) {
-    vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &texture->m_TextureDescriptorSet, 0, nullptr);
+    VkDescriptorSet textureSet = peripheral ? texture->m_PeripheryDescriptorSet : texture->m_TextureDescriptorSet;
+    vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &textureSet, 0, nullptr);
   }
 
   vkCmdPushConstants(cmdBfr, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Mat4), glm::value_ptr(d.mTransformMatrix));
 
+  BindGeometry(cmdBfr, vBuffer);
+
+  //All detail levels share the vertex data and live in the same index buffer
+  if (lod < d.mNumLODs) {
+    vkCmdDrawIndexed(cmdBfr, d.mLODs[lod].mNumFaces * 3, 1, vBuffer->m_FirstIndex + d.mLODs[lod].mFirstIndex, (int32_t)vBuffer->m_FirstVertex, 0);
+  } else {
+    vkCmdDrawIndexed(cmdBfr, d.mNumFaces * 3, 1, vBuffer->m_FirstIndex, (int32_t)vBuffer->m_FirstVertex, 0);
+  }
+}
+
+void VKBackend::BindGeometry(VkCommandBuffer cmdBfr, const VKVertexBuffer* vBuffer) {
+  //Meshes in the arena all share the same buffers, so this only binds when a pass starts or meets a mesh outside it
+  if (m_BoundGeometry.mCmdBuffer == cmdBfr && m_BoundGeometry.mVertexBuffer == vBuffer->m_Buffer &&
+      m_BoundGeometry.mIndexBuffer == vBuffer->m_IndexBuffer && m_BoundGeometry.mIndexOffset == vBuffer->m_IndexOffset) {
+    return;
+  }
+
   VkDeviceSize offsets[] = { 0 };
   vkCmdBindVertexBuffers(cmdBfr, 0, 1, &vBuffer->m_Buffer, offsets);
-  vkCmdBindIndexBuffer(cmdBfr, vBuffer->m_Buffer, vBuffer->m_IndexOffset, VK_INDEX_TYPE_UINT32);
-  vkCmdDrawIndexed(cmdBfr, d.mNumFaces * 3, 1, 0, 0, 0);
+  vkCmdBindIndexBuffer(cmdBfr, vBuffer->m_IndexBuffer, vBuffer->m_IndexOffset, VK_INDEX_TYPE_UINT32);
+
+  m_BoundGeometry.mCmdBuffer = cmdBfr;
+  m_BoundGeometry.mVertexBuffer = vBuffer->m_Buffer;
+  m_BoundGeometry.mIndexBuffer = vBuffer->m_IndexBuffer;
+  m_BoundGeometry.mIndexOffset = vBuffer->m_IndexOffset;
 }
 
 void VKBackend::DrawFrameBuffer(VkCommandBuffer cmdBfr, VkPipeline pipeline, VkDescriptorSet descSet) {
   VKVertexBuffer* vBuf = static_cast<VKVertexBuffer*>(m_FBModel.mVBuffer);
-  VkDeviceSize offsets[] = { 0 };
   vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
   vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &descSet, 0, nullptr);
-  vkCmdBindVertexBuffers(cmdBfr, 0, 1, &vBuf->m_Buffer, offsets);
-  vkCmdBindIndexBuffer(cmdBfr, vBuf->m_Buffer, vBuf->m_IndexOffset, VK_INDEX_TYPE_UINT32);
-  vkCmdDrawIndexed(cmdBfr, m_FBModel.mNumFaces * 3, 1, 0, 0, 0);
+  BindGeometry(cmdBfr, vBuf);
+  vkCmdDrawIndexed(cmdBfr, m_FBModel.mNumFaces * 3, 1, vBuf->m_FirstIndex, (int32_t)vBuf->m_FirstVertex, 0);
+}
+void VKBackend::BeginPassTimer(VkCommandBuffer cmdBfr, const TIMED_PASS pass) {
+  m_CPUPassStart[(int)pass] = SDL_GetPerformanceCounter();
+  if (m_TimestampPool != VK_NULL_HANDLE) {
+    vkCmdWriteTimestamp(cmdBfr, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_TimestampPool, GetTimestampQuery(m_TimestampFrame, pass));
+  }
+}
+
+void VKBackend::EndPassTimer(VkCommandBuffer cmdBfr, const TIMED_PASS pass) {
+  if (m_TimestampPool != VK_NULL_HANDLE) {
+    vkCmdWriteTimestamp(cmdBfr, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_TimestampPool, GetTimestampQuery(m_TimestampFrame, pass) + 1);
+  }
+  m_CPUPassTimes[(int)pass] = (float)((SDL_GetPerformanceCounter() - m_CPUPassStart[(int)pass]) * 1000000.0 / SDL_GetPerformanceFrequency());
+}
+
+u32 VKBackend::GetTimestampQuery(const u32 frame, const TIMED_PASS pass) {
+  return (frame % m_FramesInFlight) * 2 * (u32)TIMED_PASS::COUNT + 2 * (u32)pass;
+}
+
+void VKBackend::ReadPassTimes() {
+  //Nothing to read until every frame in flight has been through once
+  if (m_TimestampPool == VK_NULL_HANDLE || m_TimestampFrame < m_FramesInFlight) {
+    return;
+  }
+
+  //Read the set this frame is about to reuse, its frame's fence has just been waited on so this never stalls
+  const u32 frame = m_TimestampFrame - m_FramesInFlight;
+  u64 timestamps[2 * (int)TIMED_PASS::COUNT][2];
+  VkResult result = vkGetQueryPoolResults(m_Device.GetDevice(), m_TimestampPool, GetTimestampQuery(frame, TIMED_PASS::SHADOW), 2 * (u32)TIMED_PASS::COUNT,
+                                          sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+  if (result != VK_SUCCESS && result != VK_NOT_READY) {
+    return;
+  }
+
+  //Keep the old times if the frame's first and last pass aren't done yet
+  const int first = 2 * (int)TIMED_PASS::SHADOW;
+  const int last = 2 * (int)TIMED_PASS::PRESENT + 1;
+  if (timestamps[first][1] == 0 || timestamps[last][1] == 0) {
+    return;
+  }
+
+  //Only the low bits of each timestamp are valid
+  const u32 validBits = m_Device.GetGraphicsTimestampBits();
+  const u64 mask = validBits >= 64 ? std::numeric_limits<u64>::max() : ((u64)1 << validBits) - 1;
+  const float usPerTick = m_Device.GetDeviceProperties().limits.timestampPeriod / 1000.0f;
+
+  //Passes that were skipped that frame never wrote their timestamps, and count as taking no time
+  //The frame time is the sum of the passes, the span from first to last would also count the waits on acquire and semaphores between them
+  m_GPUFrameTime = 0.0f;
+  for (int i = 0; i < (int)TIMED_PASS::COUNT; i++) {
+    const bool written = timestamps[2 * i][1] != 0 && timestamps[2 * i + 1][1] != 0;
+    m_PassTimes[i] = written ? ((timestamps[2 * i + 1][0] - timestamps[2 * i][0]) & mask) * usPerTick : 0.0f;
+    m_GPUFrameTime += m_PassTimes[i];
+  }
+}
+
+void VKBackend::SetupFoveationLayers() {
+  //FoveationLayers counts every layer, including the base pass and the foveated square
+  if (!Config::OptionExists("FoveationLayers")) {
+    return;
+  }
+
+  const int totalLayers = Config::GetOptionInt("FoveationLayers");
+  int layerCount = totalLayers - 2;
+  if (layerCount <= 0) {
+    return;
+  }
+
+  if (layerCount > MAX_FOVEATION_LAYERS) {
+    Log::LogWarning("[VKBackend] Too many foveation layers requested, only using " + std::to_string(MAX_FOVEATION_LAYERS + 2));
+    layerCount = MAX_FOVEATION_LAYERS;
+  }
+
+  m_FoveationLayers.resize(layerCount);
+
+  //Each layer needs its own camera data in every frame in flight and a set for sampling its framebuffer
+  const u32 setsPerLayer = m_FramesInFlight + 1;
+  std::vector<VkDescriptorSetLayout> setLayouts;
+  for (int i = 0; i < layerCount; i++) {
+    for (u32 frame = 0; frame < m_FramesInFlight; frame++) {
+      setLayouts.push_back(m_PerFrameDescriptorSetLayout);
+    }
+    setLayouts.push_back(m_PerObjectDescriptorSetLayout);
+  }
+
+  VkDescriptorSetAllocateInfo descSetAllocInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+  descSetAllocInfo.descriptorPool = m_Device.GetDescriptorPool();
+  descSetAllocInfo.descriptorSetCount = setLayouts.size();
+  descSetAllocInfo.pSetLayouts = setLayouts.data();
+
+  std::vector<VkDescriptorSet> outSets(setLayouts.size());
+  VKError::CheckResult(vkAllocateDescriptorSets(m_Device.GetDevice(), &descSetAllocInfo, outSets.data()), "Could not allocate foveation layer descriptor sets");
+
+  const u32 screenWidth = m_UIFB.GetWidth();
+  const u32 screenHeight = m_UIFB.GetHeight();
+  std::vector<VkFormat> fbFormat = {m_Surface.GetDefaultFormat().format};
+
+  VkDescriptorImageInfo shadowMapInfo = m_ShadowFB.GetDepthImageInfo(m_ShadowSampler);
+
+  //Sized up front so the infos don't move while the writes point at them
+  std::vector<VkDescriptorBufferInfo> usrDataInfos(m_FramesInFlight);
+  std::vector<VkDescriptorBufferInfo> lightInfos(m_FramesInFlight);
+  for (u32 frame = 0; frame < m_FramesInFlight; frame++) {
+    usrDataInfos[frame] = mUsrDataUBO.GetBufferInfo(frame * m_UBOSliceSize, sizeof(Mat4));
+    lightInfos[frame] = mLightUBO.GetBufferInfo(frame * m_UBOSliceSize, sizeof(LightData));
+  }
+  std::vector<VkDescriptorBufferInfo> cameraInfos(layerCount * m_FramesInFlight);
+  std::vector<VkDescriptorImageInfo> fbInfos(layerCount);
+  std::vector<VkWriteDescriptorSet> descWrites;
+
+  for (int i = 0; i < layerCount; i++) {
+    FoveationLayer &layer = m_FoveationLayers[i];
+    const int layerIndex = i + 1;
+    const std::string prefix = "FoveationLayer" + std::to_string(layerIndex);
+
+    //By default spread the layers evenly between the base pass and the largest foveated square
+    int scale = 100 * layerIndex / (totalLayers - 1);
+    if (Config::OptionExists(prefix + "Scale")) {
+      scale = Config::GetOptionInt(prefix + "Scale");
+    }
+
+    int radius = (MAX_FOVEATED_SIZE / 2) * (totalLayers - 1 - layerIndex) / (totalLayers - 2);
+    if (Config::OptionExists(prefix + "Radius")) {
+      radius = Config::GetOptionInt(prefix + "Radius");
+    }
+
+    scale = std::max(5, std::min(100, scale));
+    radius = std::max((int)MIN_FOVEATED_SIZE / 2, radius);
+
+    layer.m_Scale = scale / 100.0f;
+    layer.m_Size = 2 * radius;
+    layer.m_Rect = {};
+    layer.m_RenderExtent = {0, 0};
+
+    u32 fbWidth = std::max(1u, (u32)(std::min(layer.m_Size, screenWidth) * layer.m_Scale));
+    u32 fbHeight = std::max(1u, (u32)(std::min(layer.m_Size, screenHeight) * layer.m_Scale));
+    layer.m_FB.Setup(fbWidth, fbHeight, fbFormat, VK_FORMAT_D32_SFLOAT, false, m_Device.GetDevice(), m_MemAllocator);
+
+    layer.mCameraUBO.Setup(m_FramesInFlight * m_UBOSliceSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+    layer.mCameraUBO.Map(m_MemAllocator);
+
+    layer.m_PerFrameDescriptorSets.assign(outSets.begin() + setsPerLayer * i, outSets.begin() + setsPerLayer * i + m_FramesInFlight);
+    layer.m_FBDescriptorSet = outSets[setsPerLayer * i + m_FramesInFlight];
+
+    fbInfos[i] = layer.m_FB.GetColorImageInfos(m_TextureSampler)[0];
+
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+
+    for (u32 frame = 0; frame < m_FramesInFlight; frame++) {
+      cameraInfos[i * m_FramesInFlight + frame] = layer.mCameraUBO.GetBufferInfo(frame * m_UBOSliceSize, 2 * sizeof(Mat4));
+
+      write.dstSet = layer.m_PerFrameDescriptorSets[frame];
+      write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      write.pImageInfo = nullptr;
+
+      write.dstBinding = 0;
+      write.pBufferInfo = &cameraInfos[i * m_FramesInFlight + frame];
+      descWrites.push_back(write);
+
+      write.dstBinding = 1;
+      write.pBufferInfo = &lightInfos[frame];
+      descWrites.push_back(write);
+
+      write.dstBinding = 7;
+      write.pBufferInfo = &usrDataInfos[frame];
+      descWrites.push_back(write);
+
+      write.pBufferInfo = nullptr;
+      write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      write.dstBinding = 6;
+      write.pImageInfo = &shadowMapInfo;
+      descWrites.push_back(write);
+    }
+
+    write.dstSet = layer.m_FBDescriptorSet;
+    write.dstBinding = 0;
+    write.pImageInfo = &fbInfos[i];
+    descWrites.push_back(write);
+
+    Log::LogInfo("[VKBackend] Foveation layer " + std::to_string(layerIndex) + ": " + std::to_string(scale) + "% scale, " + std::to_string(radius) + "px radius");
+  }
+
+  vkUpdateDescriptorSets(m_Device.GetDevice(), descWrites.size(), descWrites.data(), 0, nullptr);
+}
+
+void VKBackend::DrawFoveationLayer(FoveationLayer &layer, const GVec2 &gaze, const Mat4 &viewMatrix, const Mat4 &proj, const std::vector<Drawable> &scene, VkCommandBuffer cmdBfr) {
+  layer.m_Rect = GetGazeRect(gaze, layer.m_Size);
+  layer.m_RenderExtent.width = std::min(layer.m_FB.GetWidth(), (u32)(layer.m_Rect.extent.width * layer.m_Scale));
+  layer.m_RenderExtent.height = std::min(layer.m_FB.GetHeight(), (u32)(layer.m_Rect.extent.height * layer.m_Scale));
+
+  if (layer.m_RenderExtent.width == 0 || layer.m_RenderExtent.height == 0) {
+    return;
+  }
+
+  //Render just the layer's square, at the layer's resolution
+  Mat4 layerProj = GetRectProjection(proj, layer.m_Rect);
+  Mat4 matrices[] = { viewMatrix, layerProj };
+  void* data = GetUBOSlice(layer.mCameraUBO);
+  memcpy(data, matrices, 2 * sizeof(Mat4));
+
+  VkRect2D target = {};
+  target.offset = {0,0};
+  target.extent = layer.m_RenderExtent;
+
+  VkViewport viewport = {};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = (float)(target.extent.width);
+  viewport.height = (float)(target.extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(cmdBfr, 0, 1, &viewport);
+  vkCmdSetScissor(cmdBfr, 0, 1, &target);
+
+  VkClearValue clears[2] = {};
+  clears[0].color = {0.0f, 0.0f, 0.0f, 0.0f};
+  clears[1].depthStencil = {1.0f, 0};
+
+  VkRenderPassBeginInfo beginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+  beginInfo.renderPass = layer.m_FB.GetRenderPass();
+  beginInfo.framebuffer = layer.m_FB.GetFramebuffer();
+  beginInfo.renderArea = target;
+  beginInfo.clearValueCount = 2;
+  beginInfo.pClearValues = clears;
+
+  vkCmdBeginRenderPass(cmdBfr, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &layer.m_PerFrameDescriptorSets[m_FrameIndex], 0, nullptr);
+
+  DrawFrameBuffer(cmdBfr, m_FoveatedClearShader->m_Pipeline, m_DummyImage->m_TextureDescriptorSet);
+
+  Frustum layerFrustum;
+  layerFrustum.Setup(layerProj * viewMatrix);
+
+  for (const auto &model : scene) {
+    Vec3 center = model.mBoundsCenter;
+    float radius = model.mBoundsRadius;
+    TransformSphere(model.mTransformMatrix, center, radius);
+
+    if (layerFrustum.IntersectsSphere(center, radius)) {
+      DrawModel(model, cmdBfr, false, SelectLOD(model, viewMatrix, layerProj, layer.m_RenderExtent.height, true));
+    }
+  }
+
+  vkCmdEndRenderPass(cmdBfr);
 }
+
+void VKBackend::DrawComposite(VkCommandBuffer cmdBfr, VkDescriptorSet descSet, const Vec2 &center, const float radius) {
+  if (m_CompositeShader == nullptr) {
+    DrawFrameBuffer(cmdBfr, m_UIFBShader->m_Pipeline, descSet);
+    return;
+  }
+
+  //smoothstep is undefined when both edges are equal, so the fade is always at least a pixel wide
+  Vec4 blendData = Vec4(center.x, center.y, radius, std::max(std::min(m_BlendWidth, radius), 1.0f));
+  vkCmdPushConstants(cmdBfr, m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(Mat4), sizeof(Vec4), glm::value_ptr(blendData));
+  DrawFrameBuffer(cmdBfr, m_CompositeShader->m_Pipeline, descSet);
+}
+
+void VKBackend::DrawInset(VkCommandBuffer cmdBfr, VkDescriptorSet descSet, const u32 fbWidth, const u32 fbHeight, const VkRect2D &rect, const VkExtent2D &renderExtent, const Vec2 &center, const float radius) {
+  SetInsetViewport(cmdBfr, fbWidth, fbHeight, rect, renderExtent);
+  DrawComposite(cmdBfr, descSet, center, radius);
+}
+
+void VKBackend::SetInsetViewport(VkCommandBuffer cmdBfr, const u32 fbWidth, const u32 fbHeight, const VkRect2D &rect, const VkExtent2D &renderExtent) {
+  //Stretch the viewport so the rendered area lands exactly on the rectangle, and scissor away the rest
+  VkViewport viewport = {};
+  viewport.x = (float)(rect.offset.x);
+  viewport.y = (float)(rect.offset.y);
+  viewport.width = (float)(fbWidth) * rect.extent.width / renderExtent.width;
+  viewport.height = (float)(fbHeight) * rect.extent.height / renderExtent.height;
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(cmdBfr, 0, 1, &viewport);
+  vkCmdSetScissor(cmdBfr, 0, 1, &rect);
+}
+
 std::string VKBackend::GetDeviceName() {
   VkPhysicalDeviceProperties deviceProperties = m_Device.GetDeviceProperties();
   return std::string(deviceProperties.deviceName);
@@ -1387,3 +2423,366 @@ u64 VKBackend::GetUsedVRAM() {
   vmaCalculateStats(m_MemAllocator, &memStats);
   return memStats.total.usedBytes;
 }
+FrameTimings VKBackend::GetFrameTimings() {
+  FrameTimings timings;
+  timings.mCPUDraw = m_CPUDrawTime;
+  timings.mCPUShadow = m_CPUPassTimes[(int)TIMED_PASS::SHADOW];
+  timings.mCPUWorld = m_CPUPassTimes[(int)TIMED_PASS::WORLD];
+  timings.mCPUFoveated = m_CPUPassTimes[(int)TIMED_PASS::FOVEATED];
+  timings.mCPUUI = m_CPUPassTimes[(int)TIMED_PASS::UI];
+  timings.mCPUPresent = m_CPUPassTimes[(int)TIMED_PASS::PRESENT];
+  timings.mGPUTotal = m_GPUFrameTime;
+  timings.mGPUShadow = m_PassTimes[(int)TIMED_PASS::SHADOW];
+  timings.mGPUWorld = m_PassTimes[(int)TIMED_PASS::WORLD];
+  timings.mGPUFoveated = m_PassTimes[(int)TIMED_PASS::FOVEATED];
+  timings.mGPUUI = m_PassTimes[(int)TIMED_PASS::UI];
+  timings.mGPUPresent = m_PassTimes[(int)TIMED_PASS::PRESENT];
+  timings.mGPULatency = m_FramesInFlight;
+  return timings;
+}
+std::string VKBackend::GetPipelineCachePath() {
+  if (Config::OptionExists("PipelineCacheFile")) {
+    return Config::GetOptionString("PipelineCacheFile");
+  }
+
+  char* basePath = SDL_GetBasePath();
+  if (basePath == nullptr) {
+    return PIPELINE_CACHE_FILE;
+  }
+  std::string path = std::string(basePath) + PIPELINE_CACHE_FILE;
+  SDL_free(basePath);
+  return path;
+}
+
+void VKBackend::LoadPipelineCache() {
+  const VkPhysicalDeviceProperties properties = m_Device.GetDeviceProperties();
+  const std::string path = GetPipelineCachePath();
+  std::vector<char> cacheData;
+
+  std::ifstream cacheFile(path, std::ios::binary);
+  if (cacheFile) {
+    PipelineCacheFileHeader header = {};
+    cacheFile.read((char*)&header, sizeof(header));
+
+    //Drivers are meant to reject foreign caches themselves, but not all of them do
+    const bool matches = cacheFile && memcmp(header.mMagic, PIPELINE_CACHE_MAGIC, sizeof(header.mMagic)) == 0 &&
+                         header.mVendorID == properties.vendorID && header.mDeviceID == properties.deviceID &&
+                         header.mDriverVersion == properties.driverVersion &&
+                         memcmp(header.mPipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    //The stored size has to be exactly what's left of the file, anything else is a truncated or corrupt cache
+    bool sizeMatches = false;
+    if (matches) {
+      const std::streamoff dataStart = cacheFile.tellg();
+      cacheFile.seekg(0, cacheFile.end);
+      const std::streamoff remaining = cacheFile.tellg() - dataStart;
+      cacheFile.seekg(dataStart, cacheFile.beg);
+      sizeMatches = dataStart >= 0 && remaining >= 0 && header.mDataSize == (u64)remaining;
+    }
+
+    if (sizeMatches) {
+      cacheData.resize((size_t)header.mDataSize);
+      cacheFile.read(cacheData.data(), cacheData.size());
+      if (!cacheFile) {
+        cacheData.clear();
+      }
+    }
+
+    if (matches && !sizeMatches) {
+      Log::LogWarning("Ignoring pipeline cache " + path + ", its size doesn't match its header");
+    } else if (cacheData.empty()) {
+      Log::LogWarning("Ignoring pipeline cache " + path + " made for a different device or driver");
+    } else {
+      Log::LogInfo("Loaded pipeline cache " + path);
+    }
+  }
+
+  VkPipelineCacheCreateInfo cacheCreate = {VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  cacheCreate.initialDataSize = cacheData.size();
+  cacheCreate.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+  if (vkCreatePipelineCache(m_Device.GetDevice(), &cacheCreate, nullptr, &m_PipelineCache) != VK_SUCCESS) {
+    //The driver didn't like the data after all, so start from an empty cache
+    cacheCreate.initialDataSize = 0;
+    cacheCreate.pInitialData = nullptr;
+    VKError::CheckResult(vkCreatePipelineCache(m_Device.GetDevice(), &cacheCreate, nullptr, &m_PipelineCache), "Could not create pipeline cache");
+  }
+}
+
+void VKBackend::SavePipelineCache() {
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(m_Device.GetDevice(), m_PipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+    return;
+  }
+  std::vector<char> cacheData(dataSize);
+  if (vkGetPipelineCacheData(m_Device.GetDevice(), m_PipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS) {
+    return;
+  }
+
+  const VkPhysicalDeviceProperties properties = m_Device.GetDeviceProperties();
+  PipelineCacheFileHeader header = {};
+  memcpy(header.mMagic, PIPELINE_CACHE_MAGIC, sizeof(header.mMagic));
+  header.mVendorID = properties.vendorID;
+  header.mDeviceID = properties.deviceID;
+  header.mDriverVersion = properties.driverVersion;
+  memcpy(header.mPipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+  header.mDataSize = dataSize;
+
+  const std::string path = GetPipelineCachePath();
+  std::ofstream cacheFile(path, std::ios::binary | std::ios::trunc);
+  cacheFile.write((const char*)&header, sizeof(header));
+  cacheFile.write(cacheData.data(), dataSize);
+  if (!cacheFile) {
+    Log::LogWarning("Could not write pipeline cache " + path);
+  }
+}
+
+void VKBackend::SetFoveationEnabled(const bool enabled) {
+  if (enabled == m_EnableFoveatedRendering) {
+    return;
+  }
+
+  //History from the other mode can't be reused
+  m_EnableFoveatedRendering = enabled;
+  m_FoveationToggled = true;
+  m_BaseHistoryValid = false;
+  m_FoveatedHistoryValid = false;
+}
+void VKBackend::ResetTemporalState() {
+  m_BaseHistoryValid = false;
+  m_FramesSinceBaseRender = 0;
+  m_FoveatedHistoryValid = false;
+  m_InSaccade = false;
+  m_SkippedFoveatedFrames = 0;
+}
+void VKBackend::RequestFrameCapture() {
+  if (!m_CaptureBufferCreated) {
+    m_CaptureBuffer.Setup(m_UIFB.GetWidth() * m_UIFB.GetHeight() * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_MemAllocator);
+    m_CaptureBufferCreated = true;
+  }
+  m_CaptureRequested = true;
+  m_CaptureWritten = false;
+}
+bool VKBackend::GetFrameCapture(FrameCapture &capture) {
+  if (!m_CaptureWritten) {
+    return false;
+  }
+
+  //Only waits for the captured frame, later frames can stay in flight
+  vkWaitForFences(m_Device.GetDevice(), 1, &m_Frames[m_CaptureFrameIndex].m_Finished, VK_TRUE, std::numeric_limits<u64>::max());
+
+  capture.mWidth = m_UIFB.GetWidth();
+  capture.mHeight = m_UIFB.GetHeight();
+  capture.mGaze = m_CaptureGaze;
+  capture.mPixels.resize(capture.mWidth * capture.mHeight * 4);
+  memcpy(capture.mPixels.data(), m_CaptureBuffer.Map(m_MemAllocator), capture.mPixels.size());
+
+  //Swapchain formats are usually BGRA
+  const VkFormat format = m_Surface.GetDefaultFormat().format;
+  if (format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB) {
+    for (size_t i = 0; i < capture.mPixels.size(); i += 4) {
+      std::swap(capture.mPixels[i], capture.mPixels[i + 2]);
+    }
+  }
+
+  m_CaptureWritten = false;
+  return true;
+}
+void VKBackend::RecordFrameCapture(VkCommandBuffer cmdBfr) {
+  VkImageMemoryBarrier toTransfer = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  toTransfer.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.image = m_UIFB.GetColorImage(0);
+  toTransfer.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  toTransfer.subresourceRange.levelCount = 1;
+  toTransfer.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(cmdBfr, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+  VkBufferImageCopy region = {};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {m_UIFB.GetWidth(), m_UIFB.GetHeight(), 1};
+  vkCmdCopyImageToBuffer(cmdBfr, toTransfer.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_CaptureBuffer.GetBuffer(), 1, &region);
+
+  //Hand the image back to the present pass
+  VkImageMemoryBarrier toShader = toTransfer;
+  toShader.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  toShader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  toShader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  toShader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  vkCmdPipelineBarrier(cmdBfr, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toShader);
+
+  VkBufferMemoryBarrier toHost = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+  toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.buffer = m_CaptureBuffer.GetBuffer();
+  toHost.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(cmdBfr, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &toHost, 0, nullptr);
+}
+VkRect2D VKBackend::GetGazeRect(const GVec2 &gaze, const u32 size) {
+  const u32 screenWidth = m_UIFB.GetWidth();
+  const u32 screenHeight = m_UIFB.GetHeight();
+
+  u32 pixelX = gaze.x * screenWidth;
+  u32 pixelY = gaze.y * screenHeight;
+
+  int topleftX = pixelX - (size / 2);
+  int topleftY = pixelY - (size / 2);
+
+  int bottomRightX = topleftX + size;
+  int bottomRightY = topleftY + size;
+
+  //Clamp rectangle to window boundaries
+  if (topleftX < 0) {
+    topleftX = 0;
+  }
+
+  if (topleftY < 0) {
+    topleftY = 0;
+  }
+
+  if (bottomRightX > (int)screenWidth) {
+    bottomRightX = screenWidth;
+  }
+
+  if (bottomRightY > (int)screenHeight) {
+    bottomRightY = screenHeight;
+  }
+
+  VkRect2D rect = {};
+  rect.offset.x = topleftX;
+  rect.offset.y = topleftY;
+  if (bottomRightX > topleftX && bottomRightY > topleftY) {
+    rect.extent = {(u32)(bottomRightX - topleftX), (u32)(bottomRightY - topleftY)};
+  }
+  return rect;
+}
+Mat4 VKBackend::GetRectProjection(const Mat4 &proj, const VkRect2D &rect) {
+  const float screenWidth = (float)m_UIFB.GetWidth();
+  const float screenHeight = (float)m_UIFB.GetHeight();
+
+  Vec2 ndcMin = Vec2((2.0f * rect.offset.x / screenWidth) - 1.0f,
+                     (2.0f * rect.offset.y / screenHeight) - 1.0f);
+  Vec2 ndcMax = Vec2((2.0f * (rect.offset.x + rect.extent.width) / screenWidth) - 1.0f,
+                     (2.0f * (rect.offset.y + rect.extent.height) / screenHeight) - 1.0f);
+
+  return GetSubProjection(proj, ndcMin, ndcMax);
+}
+
+u32 VKBackend::SelectLOD(const Drawable &d, const Mat4 &viewMatrix, const Mat4 &proj, const u32 renderHeight, const bool useGaze) {
+  if (d.mNumLODs < 2 || renderHeight == 0) {
+    return 0;
+  }
+
+  Vec3 center = d.mBoundsCenter;
+  float radius = d.mBoundsRadius;
+  TransformSphere(d.mTransformMatrix, center, radius);
+  const float scale = d.mBoundsRadius > 0.0f ? radius / d.mBoundsRadius : 1.0f;
+
+  //Full detail when the camera is inside the bounds
+  Vec3 viewCenter = Vec3(viewMatrix * Vec4(center, 1.0f));
+  const float distance = glm::length(viewCenter);
+  if (distance <= radius) {
+    return 0;
+  }
+
+  //Angle covered by one pixel of this pass, proj[1][1] is the cotangent of half the vertical view
+  const float pixelAngle = 2.0f / (std::abs(proj[1][1]) * renderHeight);
+
+  //The smallest visible angle grows roughly linearly with eccentricity, doubling at about 2.3 degrees
+  float acuityScale = 1.0f;
+  if (useGaze) {
+    float angle = std::acos(glm::clamp(glm::dot(viewCenter / distance, m_GazeDirection), -1.0f, 1.0f));
+    float eccentricity = std::max(0.0f, angle - std::asin(std::min(1.0f, radius / distance)));
+    acuityScale += glm::degrees(eccentricity) / 2.3f;
+  }
+
+  const float allowedAngle = m_LODPixelError * pixelAngle * acuityScale;
+  const float nearestDistance = distance - radius;
+
+  u32 lod = 0;
+  for (u32 i = 1; i < d.mNumLODs; i++) {
+    if (d.mLODs[i].mError * scale / nearestDistance > allowedAngle) {
+      break;
+    }
+    lod = i;
+  }
+  return lod;
+}
+
+Vec3 VKBackend::GetGazeFocusPoint(const Mat4 &viewMatrix, const std::vector<Drawable> &scene) {
+  const Mat4 inverseView = glm::inverse(viewMatrix);
+  const Vec3 origin = Vec3(inverseView[3]);
+  const Vec3 direction = glm::normalize(Vec3(inverseView * Vec4(m_GazeDirection, 0.0f)));
+
+  float focusDistance = std::numeric_limits<float>::max();
+  for (const auto &d : scene) {
+    Vec3 center = d.mBoundsCenter;
+    float radius = d.mBoundsRadius;
+    TransformSphere(d.mTransformMatrix, center, radius);
+
+    //Spheres around the camera say nothing about where the gaze lands
+    const Vec3 toCenter = center - origin;
+    const float centerDistanceSq = glm::dot(toCenter, toCenter);
+    if (centerDistanceSq <= radius * radius) {
+      continue;
+    }
+
+    const float along = glm::dot(toCenter, direction);
+    const float missSq = centerDistanceSq - along * along;
+    if (along <= 0.0f || missSq > radius * radius) {
+      continue;
+    }
+    focusDistance = std::min(focusDistance, along - std::sqrt(radius * radius - missSq));
+  }
+
+  if (focusDistance == std::numeric_limits<float>::max()) {
+    focusDistance = m_GazeShadowDistance;
+  }
+  return origin + direction * focusDistance;
+}
+
+void VKBackend::DrawShadowCasters(VkCommandBuffer cmdBfr, const std::vector<Drawable> &scene, const Mat4 &lightSpace, const VkRect2D &region, const bool cull) {
+  VkViewport shadowViewport = {};
+  shadowViewport.x = (float)region.offset.x;
+  shadowViewport.y = (float)region.offset.y;
+  shadowViewport.width = (float)region.extent.width;
+  shadowViewport.height = (float)region.extent.height;
+  shadowViewport.minDepth = 0.0f;
+  shadowViewport.maxDepth = 1.0f;
+  vkCmdSetViewport(cmdBfr, 0, 1, &shadowViewport);
+  vkCmdSetScissor(cmdBfr, 0, 1, &region);
+
+  Frustum lightFrustum;
+  lightFrustum.Setup(lightSpace);
+
+  for (const auto& m : scene) {
+    if (cull) {
+      Vec3 center = m.mBoundsCenter;
+      float radius = m.mBoundsRadius;
+      TransformSphere(m.mTransformMatrix, center, radius);
+      if (!lightFrustum.IntersectsSphere(center, radius)) {
+        continue;
+      }
+    }
+
+    VKVertexBuffer * vBuffer = static_cast<VKVertexBuffer*>(m.mVBuffer);
+
+    if (m.mTexture == nullptr) {
+      vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &m_DummyImage->m_TextureDescriptorSet, 0, nullptr);
+    } else {
+      VKTexture* texture = static_cast<VKTexture*>(m.mTexture);
+      vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &texture->m_TextureDescriptorSet, 0, nullptr);
+    }
+    Mat4 modelMatrix = lightSpace * m.mTransformMatrix;
+
+    vkCmdPushConstants(cmdBfr, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Mat4), glm::value_ptr(modelMatrix));
+
+    BindGeometry(cmdBfr, vBuffer);
+    vkCmdDrawIndexed(cmdBfr, m.mNumFaces * 3, 1, vBuffer->m_FirstIndex, (int32_t)vBuffer->m_FirstVertex, 0);
+  }
+}
@@ -10,6 +10,13 @@
 #include "VKShader.h"
 #include "VKFrameBuffer.h"
 #include "VKTexture.h"
+#include "VKPipelineCompiler.h"
+#include "VKUploader.h"
+#include "VKGeometryArena.h"
+#include "VKVertexBuffer.h"
+#include "../../FoveationController.h"
+
+struct GVec2;
 
 class VKBackend : public RenderBackend {
 public:
@@ -20,6 +27,8 @@ public:
   const Model LoadModel(const std::vector<Vertex> vertices, const std::vector<u32> indices);
   Texture* LoadTexture(const unsigned char* data, const int width, const int height, const int numChannels);
   Shader* CreateShader(const std::vector<char> vertexProgram, const std::vector<char> fragmentProgram, const DRAW_STAGE stage);
+  Shader* CreateShaderAsync(const std::vector<char> vertexProgram, const std::vector<char> fragmentProgram, const DRAW_STAGE stage);
+  bool IsShaderReady(Shader* shader);
   void SetFrameBufferModel(const Model &model);
   void SetFrameBufferShader(Shader* shader, const DRAW_STAGE stage);
 
@@ -34,6 +43,12 @@ public:
 
   std::string GetDeviceName();
   u64 GetUsedVRAM();
+  FrameTimings GetFrameTimings();
+
+  void SetFoveationEnabled(const bool enabled);
+  void ResetTemporalState();
+  void RequestFrameCapture();
+  bool GetFrameCapture(FrameCapture &capture);
 
 private:
   VKSurface m_Surface;
@@ -47,6 +62,9 @@ private:
   VKFrameBuffer m_UIFB;
   VKFrameBuffer m_ShadowFB;
   VKFrameBuffer m_FoveatedFB;
+
+  //Area of the world framebuffer the base pass renders to
+  VkExtent2D m_WorldExtent;
   VkDescriptorSet m_WorldFBDescriptorSet;
   VkDescriptorSet m_UIFBDescriptorSet;
   VkDescriptorSet m_FoveatedDescriptorSet;
@@ -55,43 +73,309 @@ private:
   VKShader* m_AspectShader;
   VKShader* m_FoveatedClearShader;
 
-  VkCommandBuffer m_WorldCmdBuffer;
-  VkCommandBuffer m_FoveatedCmdBuffer;
-  VkCommandBuffer m_UICmdBuffer;
-  VkCommandBuffer m_PresentCmdBuffer;
-  VkCommandBuffer m_ShadowCmdBuffer;
+  //Blends layers over each other with a radial falloff around the gaze point, null when disabled
+  VKShader* m_CompositeShader;
+  float m_BlendWidth;
+
+  //The base pass is only re-rendered every m_PeripheryUpdateRate frames and reprojected in between, null shader when disabled
+  VKShader* m_ReprojectShader;
+  u32 m_PeripheryUpdateRate;
+  u32 m_FramesSinceBaseRender;
+  bool m_BaseHistoryValid;
+  Mat4 m_BaseHistoryViewProj;
+  VkExtent2D m_BaseHistoryExtent;
+  VKBuffer mReprojectUBO;
+
+  //Depth aware upsampling of the base pass to screen resolution, null when disabled
+  VKShader* m_UpsampleShader;
+  float m_UpsampleSensitivity;
+
+  //Everything the CPU writes while recording a frame, one set for each frame that can be in flight
+  //The framebuffers are shared, their render passes order them against the frames before
+  struct FrameResources {
+    VkCommandBuffer m_WorldCmdBuffer;
+    VkCommandBuffer m_FoveatedCmdBuffer;
+    VkCommandBuffer m_UICmdBuffer;
+    VkCommandBuffer m_PresentCmdBuffer;
+    VkCommandBuffer m_ShadowCmdBuffer;
 
-  VkSemaphore m_ImageAvailable;
-  VkSemaphore m_RenderFinished;
-  VkSemaphore m_ShadowToFoveated;
+    VkSemaphore m_ImageAvailable;
+    VkSemaphore m_RenderFinished;
+    VkSemaphore m_ShadowToFoveated;
+    VkFence m_Finished;
+
+    VkDescriptorSet m_PerFrameDescriptorSet;
+    VkDescriptorSet m_FoveatedPerFrameDescriptorSet;
+
+    //Exposes the base pass depth in the shadow map slot, and the reprojection matrix in the camera slot
+    VkDescriptorSet m_WorldDepthDescriptorSet;
+  };
+
+  std::vector<FrameResources> m_Frames;
+  u32 m_FramesInFlight;
+  u32 m_FrameIndex;
+  //Swapchain image the current frame presents, headless mode just takes turns through its offscreen images
+  u32 m_ImageIndex;
 
   VkDescriptorSetLayout m_PerFrameDescriptorSetLayout;
   VkDescriptorSetLayout m_PerObjectDescriptorSetLayout;
-  VkDescriptorSet m_PerFrameDescriptorSet;
   VkPipelineLayout m_PipelineLayout;
 
+  //Uniform buffers hold a slice for each frame in flight, m_UBOSliceSize apart
   VKBuffer mCameraUBO;
+  VKBuffer mFoveatedCameraUBO;
   VKBuffer mLightUBO;
   VKBuffer mUsrDataUBO;
+  VkDeviceSize m_UBOSliceSize;
 
-  VKBuffer m_StagingBuffer;
+  VKUploader m_Uploader;
+  VKGeometryArena m_GeometryArena;
+
+  //Geometry last bound by BindGeometry, reset whenever something else may have bound buffers
+  struct BoundGeometry {
+    VkCommandBuffer mCmdBuffer;
+    VkBuffer mVertexBuffer;
+    VkBuffer mIndexBuffer;
+    VkDeviceSize mIndexOffset;
+  };
+  BoundGeometry m_BoundGeometry;
 
   VkSampler m_TextureSampler;
   VkSampler m_ShadowSampler;
 
+  //Mipmapped model textures, the periphery sampler skips detail the base pass can't show
+  VkSampler m_ModelTextureSampler;
+  VkSampler m_PeripheryTextureSampler;
+
   VKShader* m_ShadowShader;
 
   VKTexture* m_DummyImage;
 
-  VkFence m_LastFrameFinished;
-
   u32 m_ShadowSize;
 
+  //Split the shadow map into a small cascade around the gaze point and a cheap one for the whole scene
+  bool m_GazeShadowCascade;
+  u32 m_GazeShadowSize;
+  float m_GazeShadowRadius;
+  float m_GazeShadowDistance;
+
+  //Render the foveated region into a small off-center framebuffer instead of a full screen one
+  bool m_FoveatedInset;
+
+  //Grow the foveated region to cover both eyes' gaze points when the tracker reports them separately
+  bool m_BinocularFoveation;
+
+  //Gaze centered layer drawn between the base pass and the foveated square
+  struct FoveationLayer {
+    VKFrameBuffer m_FB;
+    VkDescriptorSet m_FBDescriptorSet;
+    VKBuffer mCameraUBO;
+    std::vector<VkDescriptorSet> m_PerFrameDescriptorSets;
+    float m_Scale;
+    u32 m_Size;
+    VkRect2D m_Rect;
+    VkExtent2D m_RenderExtent;
+  };
+
+  //Ordered from the outermost layer inwards
+  std::vector<FoveationLayer> m_FoveationLayers;
+
+  //Passes timed with GPU timestamps, each gets a start and end query
+  enum class TIMED_PASS {
+    SHADOW,
+    WORLD,
+    FOVEATED,
+    UI,
+    PRESENT,
+    COUNT
+  };
+
+  //Each frame writes its own set of timestamps, which get read back a couple of frames later so reading never waits on the GPU
+  VkQueryPool m_TimestampPool;
+  u32 m_TimestampFrame;
+
+  //Microseconds taken by each pass and the whole frame, from the frame the timestamps were last read for
+  float m_PassTimes[(int)TIMED_PASS::COUNT];
+  float m_GPUFrameTime;
+
+  FoveationController m_FoveationController;
+
+  //Parts of the gaze to photon latency in microseconds, the GPU part comes from m_GPUFrameTime
+  float m_CPULatency;
+  float m_DisplayLatency;
+
+  //CPU time spent recording and submitting the last frame, in microseconds
+  float m_CPUDrawTime;
+
+  //CPU time spent recording each pass of the last frame, in microseconds, timed alongside the pass timestamps
+  u64 m_CPUPassStart[(int)TIMED_PASS::COUNT];
+  float m_CPUPassTimes[(int)TIMED_PASS::COUNT];
+
+  //Saccadic suppression skips the foveated pass while the eye moves too fast to see detail
+  bool m_SaccadeSuppression;
+  float m_SaccadeOnsetSpeed;
+  float m_SaccadeOffsetSpeed;
+  u32 m_MaxSkippedFrames;
+  bool m_InSaccade;
+  float m_GazeSpeed;
+  u32 m_SkippedFoveatedFrames;
+
+  //Last foveated image that was rendered, reused while the pass is skipped
+  bool m_FoveatedHistoryValid;
+  VkRect2D m_LastFoveatedRect;
+  Vec2 m_LastFoveatedCenter;
+  float m_LastFoveatedRadius;
+
+  //Overall foveated rendering control, and the base pass scale to go back to when foveation is turned back on
+  bool m_EnableFoveatedRendering;
+  bool m_FoveationToggled;
+  float m_BaseResScale;
+
+  //Frame capture, the UI framebuffer gets copied into a host visible buffer at the end of the UI pass
+  VKBuffer m_CaptureBuffer;
+  bool m_CaptureBufferCreated;
+  bool m_CaptureRequested;
+  bool m_CaptureWritten;
+  Vec2 m_CaptureGaze;
+  u32 m_CaptureFrameIndex;
+
+  //Mesh detail selection, the allowed error in pixels at the gaze point and the view space gaze direction for this frame
+  float m_LODPixelError;
+  Vec3 m_GazeDirection;
+
   VkPipeline CreateGraphicsPipeline(const VkShaderModule vertexModule, const VkShaderModule fragModule, const VkRenderPass renderpass, const VkExtent2D renderExtent);
 
+  //Shared by every pipeline, loaded at startup and written back on shutdown so warm launches skip most shader compilation
+  VkPipelineCache m_PipelineCache;
+
+  std::string GetPipelineCachePath();
+  void LoadPipelineCache();
+  void SavePipelineCache();
+
+  VKPipelineCompiler m_PipelineCompiler;
+
+  /*!
+  * Gets the render pass and extent pipelines for a draw stage are made for
+  * @param[in] stage The draw stage
+  * @param[out] rp The render pass of the stage's framebuffer
+  * @param[out] extent The size of the stage's framebuffer
+  */
+  void GetStageTarget(const DRAW_STAGE stage, VkRenderPass &rp, VkExtent2D &extent);
+
+  /*!
+  * Builds a shader's pipeline and marks it ready, safe to call from the compiler's worker threads
+  */
+  void BuildShaderPipeline(VKShader* shader, const std::vector<char> &vertexProgram, const std::vector<char> &fragmentProgram, const VkRenderPass rp, const VkExtent2D extent);
+
   VkCommandBuffer MakeOneTimeBuffer();
   void SubmitOneTimeBuffer(VkQueue queue, VkCommandBuffer &command);
 
-  void DrawModel(const Drawable &d, VkCommandBuffer cmdBfr);
+  /*!
+  * Gets this frame's part of a uniform buffer
+  * @param[in] ubo The buffer, which holds a slice for each frame in flight
+  * @return The mapped pointer to this frame's slice
+  */
+  void* GetUBOSlice(VKBuffer &ubo);
+
+  void DrawModel(const Drawable &d, VkCommandBuffer cmdBfr, const bool peripheral = false, const u32 lod = 0);
   void DrawFrameBuffer(VkCommandBuffer cmdBfr, VkPipeline pipeline, VkDescriptorSet descSet);
+
+  /*!
+  * Binds a mesh's vertex and index buffers, skipped when they are already bound in this command buffer
+  * @param[in] cmdBfr The command buffer to record into
+  * @param[in] vBuffer The mesh's buffers
+  */
+  void BindGeometry(VkCommandBuffer cmdBfr, const VKVertexBuffer* vBuffer);
+
+  void BeginPassTimer(VkCommandBuffer cmdBfr, const TIMED_PASS pass);
+  void EndPassTimer(VkCommandBuffer cmdBfr, const TIMED_PASS pass);
+  u32 GetTimestampQuery(const u32 frame, const TIMED_PASS pass);
+  void ReadPassTimes();
+
+  /*!
+  * Copies the finished UI framebuffer into the capture buffer
+  * @param[in] cmdBfr The command buffer to record into, after the UI render pass has ended
+  */
+  void RecordFrameCapture(VkCommandBuffer cmdBfr);
+
+  void SetupFoveationLayers();
+  void DrawFoveationLayer(FoveationLayer &layer, const GVec2 &gaze, const Mat4 &viewMatrix, const Mat4 &proj, const std::vector<Drawable> &scene, VkCommandBuffer cmdBfr);
+
+  /*!
+  * Draws a full screen foveation layer over the current framebuffer
+  * Uses the composite shader to fade the layer out around its edge when it is enabled
+  * @param[in] cmdBfr The command buffer to record into
+  * @param[in] descSet The descriptor set holding the layer's color image
+  * @param[in] center The gaze point in screen pixels
+  * @param[in] radius The radius of the layer in screen pixels
+  */
+  void DrawComposite(VkCommandBuffer cmdBfr, VkDescriptorSet descSet, const Vec2 &center, const float radius);
+
+  /*!
+  * Draws a framebuffer rendered for a sub rectangle of the screen back over that rectangle
+  * @param[in] cmdBfr The command buffer to record into
+  * @param[in] descSet The descriptor set holding the framebuffer's color image
+  * @param[in] fbWidth The width of the whole framebuffer
+  * @param[in] fbHeight The height of the whole framebuffer
+  * @param[in] rect The screen rectangle to cover
+  * @param[in] renderExtent The area in the top left of the framebuffer that holds the rectangle's image
+  * @param[in] center The gaze point in screen pixels
+  * @param[in] radius The radius of the layer in screen pixels
+  */
+  void DrawInset(VkCommandBuffer cmdBfr, VkDescriptorSet descSet, const u32 fbWidth, const u32 fbHeight, const VkRect2D &rect, const VkExtent2D &renderExtent, const Vec2 &center, const float radius);
+
+  /*!
+  * Sets the viewport and scissor so drawing a full screen quad maps part of a framebuffer onto a screen rectangle
+  * @param[in] cmdBfr The command buffer to record into
+  * @param[in] fbWidth The width of the whole framebuffer
+  * @param[in] fbHeight The height of the whole framebuffer
+  * @param[in] rect The screen rectangle to cover
+  * @param[in] renderExtent The area in the top left of the framebuffer that gets mapped onto the rectangle
+  */
+  void SetInsetViewport(VkCommandBuffer cmdBfr, const u32 fbWidth, const u32 fbHeight, const VkRect2D &rect, const VkExtent2D &renderExtent);
+
+  /*!
+  * Finds the square around the gaze point, clamped to the screen
+  * @param[in] gaze The gaze point, in 0 to 1 screen coordinates
+  * @param[in] size The side length of the square in pixels
+  * @return The clamped square in screen pixels
+  */
+  VkRect2D GetGazeRect(const GVec2 &gaze, const u32 size);
+
+  /*!
+  * Narrows a projection matrix to a rectangle of the screen
+  * @param[in] proj The full screen projection matrix
+  * @param[in] rect The rectangle in screen pixels
+  * @return The off-center projection matrix for the rectangle
+  */
+  Mat4 GetRectProjection(const Mat4 &proj, const VkRect2D &rect);
+
+  /*!
+  * Picks the coarsest detail level whose error can't be seen, from the distance and angle to the gaze point
+  * @param[in] d The drawable to pick a level for
+  * @param[in] viewMatrix The camera view matrix
+  * @param[in] proj The projection the pass renders with
+  * @param[in] renderHeight The height in pixels the projection is rendered at
+  * @param[in] useGaze Whether to allow more error away from the gaze point, or only use distance
+  * @return The index into the drawable's detail levels
+  */
+  u32 SelectLOD(const Drawable &d, const Mat4 &viewMatrix, const Mat4 &proj, const u32 renderHeight, const bool useGaze);
+
+  /*!
+  * Finds the point in the world the user is looking at, from the first bounding sphere the gaze ray enters
+  * @param[in] viewMatrix The camera view matrix
+  * @param[in] scene The drawables to test against
+  * @return The world space point, at a fixed distance along the gaze ray when nothing is hit
+  */
+  Vec3 GetGazeFocusPoint(const Mat4 &viewMatrix, const std::vector<Drawable> &scene);
+
+  /*!
+  * Draws shadow casters into one region of the shadow map
+  * @param[in] cmdBfr The command buffer, inside the shadow render pass
+  * @param[in] scene The drawables to draw
+  * @param[in] lightSpace The light projection and view matrix for this region
+  * @param[in] region The part of the shadow map to draw into, in texels
+  * @param[in] cull Whether to skip drawables outside the light frustum
+  */
+  void DrawShadowCasters(VkCommandBuffer cmdBfr, const std::vector<Drawable> &scene, const Mat4 &lightSpace, const VkRect2D &region, const bool cull);
 };
\ No newline at end of file
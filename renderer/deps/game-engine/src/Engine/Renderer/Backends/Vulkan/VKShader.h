@@ -2,7 +2,10 @@
 
 #include "../../Shader.h"
 #include <vulkan/vulkan.h>
+#include <atomic>
 class VKShader : public Shader {
 public:
-  VkPipeline m_Pipeline;
-};
\ No newline at end of file
+  VkPipeline m_Pipeline = VK_NULL_HANDLE;
+  //Cleared while the pipeline is still being built on a worker thread
+  std::atomic<bool> m_Ready{true};
+};
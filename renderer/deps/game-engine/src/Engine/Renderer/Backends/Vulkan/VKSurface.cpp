@@ -2,6 +2,7 @@
 #include "../../../CommonTypes.h"
 #include "../../../Log.h"
 #include <SDL_vulkan.h>
+#include <algorithm>
 #include "VKError.h"
 
 VKSurface::VKSurface() {
@@ -11,9 +12,18 @@ VKSurface::VKSurface() {
   m_SwapchainExtent.height = 0;
   m_SwapchainExtent.width = 0;
   m_PresentRenderPass = VK_NULL_HANDLE;
+  m_Swapchain = VK_NULL_HANDLE;
+  m_Headless = false;
 }
 
-void VKSurface::CreateWindow(const std::string &windowName, const int width, const int height) {
+void VKSurface::CreateWindow(const std::string &windowName, const int width, const int height, const bool headless) {
+  m_Headless = headless;
+  if (m_Headless) {
+    m_SwapchainExtent.width = width;
+    m_SwapchainExtent.height = height;
+    return;
+  }
+
   m_Window = SDL_CreateWindow(windowName.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_VULKAN | SDL_WINDOW_FULLSCREEN);
 
   if (m_Window == nullptr) {
@@ -24,6 +34,10 @@ void VKSurface::CreateWindow(const std::string &windowName, const int width, con
 std::vector<const char *> VKSurface::GetInstanceExtensions() {
   u32 extensionCount = 0;
 
+  if (m_Headless) {
+    return std::vector<const char *>();
+  }
+
   SDL_Vulkan_GetInstanceExtensions(m_Window, &extensionCount, nullptr);
   std::vector<const char *> extensions(extensionCount);
   SDL_Vulkan_GetInstanceExtensions(m_Window, &extensionCount, extensions.data());
@@ -32,6 +46,9 @@ std::vector<const char *> VKSurface::GetInstanceExtensions() {
 }
 
 void VKSurface::CreateSurface(VkInstance instance) {
+  if (m_Headless) {
+    return;
+  }
   SDL_Vulkan_CreateSurface(m_Window, instance, &m_Surface);
 }
 
@@ -64,72 +81,11 @@ VkSurfaceFormatKHR VKSurface::SelectSurfaceFormat(const std::vector<VkSurfaceFor
 VkSurfaceFormatKHR VKSurface::GetDefaultFormat() {
   return m_DefaultSurfaceFormat;
 }
-void VKSurface::CreateSwapchain(VkPhysicalDevice physicalDevice, VkDevice device) {
-
-  //Fill in formats
-  u32 surfaceFormatCount = 0;
-  vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_Surface, &surfaceFormatCount, nullptr);
-  m_SurfaceFormats.resize(surfaceFormatCount);
-  vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_Surface, &surfaceFormatCount, m_SurfaceFormats.data());
-
-  //Fill in capabilities
-  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, m_Surface, &m_SurfaceCapabilities);
-
-  //Fill in present modes
-  u32 presentModeCount = 0;
-  vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, m_Surface, &presentModeCount, nullptr);
-  m_SurfacePresentModes.resize(presentModeCount);
-  vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, m_Surface, &presentModeCount, m_SurfacePresentModes.data());
-
-  //Select a good default surface format
-  m_DefaultSurfaceFormat = SelectSurfaceFormat(m_SurfaceFormats);
-
-  m_SwapchainExtent = m_SurfaceCapabilities.minImageExtent;
-
-  //Create swapchain
-  VkSwapchainCreateInfoKHR scCreateInfo = {VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
-  scCreateInfo.surface = m_Surface;
-  scCreateInfo.minImageCount = m_SurfaceCapabilities.minImageCount;
-  scCreateInfo.imageFormat = m_DefaultSurfaceFormat.format;
-  scCreateInfo.imageColorSpace = m_DefaultSurfaceFormat.colorSpace;
-  scCreateInfo.imageExtent = m_SurfaceCapabilities.minImageExtent;
-  scCreateInfo.imageArrayLayers = 1;
-  scCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-  scCreateInfo.queueFamilyIndexCount = 0;
-  scCreateInfo.pQueueFamilyIndices = nullptr;
-  scCreateInfo.preTransform = m_SurfaceCapabilities.currentTransform;
-  scCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-  scCreateInfo.presentMode = SelectPresentMode(m_SurfacePresentModes);
-  scCreateInfo.clipped = VK_TRUE;
-  scCreateInfo.oldSwapchain = VK_NULL_HANDLE;
-
-  VKError::CheckResult(vkCreateSwapchainKHR(device, &scCreateInfo, nullptr, &m_Swapchain), "Could not create swapchain");
-
-  //Get image handles
-  u32 scImageCount = 0;
-  vkGetSwapchainImagesKHR(device, m_Swapchain, &scImageCount, nullptr);
-  m_SwapchainImages.resize(scImageCount);
-  vkGetSwapchainImagesKHR(device, m_Swapchain, &scImageCount, m_SwapchainImages.data());
-
-  //Create image view handles
-  m_SwapchainImageViews.resize(scImageCount);
-  for (u32 i = 0; i < m_SwapchainImages.size(); i++) {
-    VkImageViewCreateInfo imageViewCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
-    imageViewCreateInfo.image = m_SwapchainImages[i];
-    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    imageViewCreateInfo.format = m_DefaultSurfaceFormat.format;
-    imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-    imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imageViewCreateInfo.subresourceRange.levelCount = 1;
-    imageViewCreateInfo.subresourceRange.layerCount = 1;
-    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-
-    vkCreateImageView(device, &imageViewCreateInfo, nullptr, &m_SwapchainImageViews[i]);
+void VKSurface::CreateSwapchain(VkPhysicalDevice physicalDevice, VkDevice device, const u32 offscreenImageCount) {
+  if (m_Headless) {
+    CreateOffscreenImages(physicalDevice, device, offscreenImageCount);
+  } else {
+    CreateWindowSwapchain(physicalDevice, device);
   }
 
   //Create renderpass
@@ -142,7 +98,7 @@ void VKSurface::CreateSwapchain(VkPhysicalDevice physicalDevice, VkDevice device
     colorAttachDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachDesc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachDesc.finalLayout = m_Headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachRef = {};
     colorAttachRef.attachment = 0;
@@ -209,9 +165,17 @@ void VKSurface::Destroy(VkInstance instance, VkDevice device) {
   for (const auto& fb : m_Framebuffers) {
     vkDestroyFramebuffer(device, fb, nullptr);
   }
+  vkDestroyRenderPass(device, m_PresentRenderPass, nullptr);
+
+  if (m_Headless) {
+    for (u32 i = 0; i < m_SwapchainImages.size(); i++) {
+      vkDestroyImage(device, m_SwapchainImages[i], nullptr);
+      vkFreeMemory(device, m_OffscreenMemory[i], nullptr);
+    }
+    return;
+  }
   vkDestroySwapchainKHR(device, m_Swapchain, nullptr);
   vkDestroySurfaceKHR(instance, m_Surface, nullptr);
-  vkDestroyRenderPass(device, m_PresentRenderPass, nullptr);
   SDL_DestroyWindow(m_Window);
 }
 VkSwapchainKHR VKSurface::GetSwapchain() {
@@ -235,3 +199,141 @@ VkRenderPass &VKSurface::GetRenderPass() {
 VkFramebuffer &VKSurface::GetFramebuffer(u32 index) {
   return m_Framebuffers[index];
 }
+bool VKSurface::IsHeadless() {
+  return m_Headless;
+}
+VkImage VKSurface::GetSwapchainImage(u32 index) {
+  return m_SwapchainImages[index];
+}
+void VKSurface::CreateOffscreenImages(VkPhysicalDevice physicalDevice, VkDevice device, const u32 imageCount) {
+  //Stand in for what a swapchain would report
+  m_DefaultSurfaceFormat.format = VK_FORMAT_B8G8R8A8_UNORM;
+  m_DefaultSurfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+  m_SurfaceFormats = {m_DefaultSurfaceFormat};
+  m_SurfaceCapabilities.minImageCount = std::max(2u, imageCount);
+  m_SurfaceCapabilities.maxImageCount = m_SurfaceCapabilities.minImageCount;
+  m_SurfaceCapabilities.currentExtent = m_SwapchainExtent;
+  m_SurfaceCapabilities.minImageExtent = m_SwapchainExtent;
+  m_SurfaceCapabilities.maxImageExtent = m_SwapchainExtent;
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  m_SwapchainImages.resize(m_SurfaceCapabilities.minImageCount);
+  m_SwapchainImageViews.resize(m_SwapchainImages.size());
+  m_OffscreenMemory.resize(m_SwapchainImages.size());
+  for (u32 i = 0; i < m_SwapchainImages.size(); i++) {
+    //Copied out of for reading the frame back
+    VkImageCreateInfo imageCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = m_DefaultSurfaceFormat.format;
+    imageCreateInfo.extent = {m_SwapchainExtent.width, m_SwapchainExtent.height, 1};
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VKError::CheckResult(vkCreateImage(device, &imageCreateInfo, nullptr, &m_SwapchainImages[i]), "Could not create offscreen image");
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, m_SwapchainImages[i], &requirements);
+
+    //Prefer device local memory, software implementations may not have any
+    u32 memoryType = memoryProperties.memoryTypeCount;
+    for (u32 type = 0; type < memoryProperties.memoryTypeCount; type++) {
+      if (requirements.memoryTypeBits & (1 << type)) {
+        if (memoryType == memoryProperties.memoryTypeCount ||
+            (memoryProperties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+          memoryType = type;
+        }
+        if (memoryProperties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+          break;
+        }
+      }
+    }
+
+    VkMemoryAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryType;
+    VKError::CheckResult(vkAllocateMemory(device, &allocInfo, nullptr, &m_OffscreenMemory[i]), "Could not allocate offscreen image memory");
+    VKError::CheckResult(vkBindImageMemory(device, m_SwapchainImages[i], m_OffscreenMemory[i], 0), "Could not bind offscreen image memory");
+
+    VkImageViewCreateInfo imageViewCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    imageViewCreateInfo.image = m_SwapchainImages[i];
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = m_DefaultSurfaceFormat.format;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+    VKError::CheckResult(vkCreateImageView(device, &imageViewCreateInfo, nullptr, &m_SwapchainImageViews[i]), "Could not create offscreen image view");
+  }
+}
+void VKSurface::CreateWindowSwapchain(VkPhysicalDevice physicalDevice, VkDevice device) {
+  //Fill in formats
+  u32 surfaceFormatCount = 0;
+  vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_Surface, &surfaceFormatCount, nullptr);
+  m_SurfaceFormats.resize(surfaceFormatCount);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_Surface, &surfaceFormatCount, m_SurfaceFormats.data());
+
+  //Fill in capabilities
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, m_Surface, &m_SurfaceCapabilities);
+
+  //Fill in present modes
+  u32 presentModeCount = 0;
+  vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, m_Surface, &presentModeCount, nullptr);
+  m_SurfacePresentModes.resize(presentModeCount);
+  vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, m_Surface, &presentModeCount, m_SurfacePresentModes.data());
+
+  //Select a good default surface format
+  m_DefaultSurfaceFormat = SelectSurfaceFormat(m_SurfaceFormats);
+
+  m_SwapchainExtent = m_SurfaceCapabilities.minImageExtent;
+
+  //Create swapchain
+  VkSwapchainCreateInfoKHR scCreateInfo = {VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
+  scCreateInfo.surface = m_Surface;
+  scCreateInfo.minImageCount = m_SurfaceCapabilities.minImageCount;
+  scCreateInfo.imageFormat = m_DefaultSurfaceFormat.format;
+  scCreateInfo.imageColorSpace = m_DefaultSurfaceFormat.colorSpace;
+  scCreateInfo.imageExtent = m_SurfaceCapabilities.minImageExtent;
+  scCreateInfo.imageArrayLayers = 1;
+  scCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  scCreateInfo.queueFamilyIndexCount = 0;
+  scCreateInfo.pQueueFamilyIndices = nullptr;
+  scCreateInfo.preTransform = m_SurfaceCapabilities.currentTransform;
+  scCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+  scCreateInfo.presentMode = SelectPresentMode(m_SurfacePresentModes);
+  scCreateInfo.clipped = VK_TRUE;
+  scCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+
+  VKError::CheckResult(vkCreateSwapchainKHR(device, &scCreateInfo, nullptr, &m_Swapchain), "Could not create swapchain");
+
+  //Get image handles
+  u32 scImageCount = 0;
+  vkGetSwapchainImagesKHR(device, m_Swapchain, &scImageCount, nullptr);
+  m_SwapchainImages.resize(scImageCount);
+  vkGetSwapchainImagesKHR(device, m_Swapchain, &scImageCount, m_SwapchainImages.data());
+
+  //Create image view handles
+  m_SwapchainImageViews.resize(scImageCount);
+  for (u32 i = 0; i < m_SwapchainImages.size(); i++) {
+    VkImageViewCreateInfo imageViewCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    imageViewCreateInfo.image = m_SwapchainImages[i];
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = m_DefaultSurfaceFormat.format;
+    imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+
+    vkCreateImageView(device, &imageViewCreateInfo, nullptr, &m_SwapchainImageViews[i]);
+  }
+}
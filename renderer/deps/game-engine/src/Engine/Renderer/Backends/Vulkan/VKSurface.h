@@ -8,9 +8,10 @@
 class VKSurface {
 public:
   VKSurface();
-  void CreateWindow(const std::string& windowName, const int width, const int height);
+  void CreateWindow(const std::string& windowName, const int width, const int height, const bool headless);
   void CreateSurface(VkInstance instance);
-  void CreateSwapchain(VkPhysicalDevice physicalDevice, VkDevice device);
+  //Headless surfaces make offscreenImageCount images, enough that no frame in flight renders into an image another is still using
+  void CreateSwapchain(VkPhysicalDevice physicalDevice, VkDevice device, const u32 offscreenImageCount);
   void Destroy(VkInstance instance, VkDevice device);
   VkSurfaceKHR GetSurface();
   VkSurfaceCapabilitiesKHR GetCapabilities();
@@ -22,10 +23,16 @@ public:
   VkSwapchainKHR GetSwapchain();
   VkRenderPass& GetRenderPass();
   VkFramebuffer& GetFramebuffer(u32 index);
+
+  //Headless surfaces have no window or swapchain, frames are rendered into offscreen images instead
+  bool IsHeadless();
+  VkImage GetSwapchainImage(u32 index);
 private:
 
   VkSurfaceFormatKHR SelectSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &formats);
   VkPresentModeKHR SelectPresentMode(const std::vector<VkPresentModeKHR> &modes);
+  void CreateWindowSwapchain(VkPhysicalDevice physicalDevice, VkDevice device);
+  void CreateOffscreenImages(VkPhysicalDevice physicalDevice, VkDevice device, const u32 imageCount);
 
   SDL_Window* m_Window;
   VkSurfaceKHR m_Surface;
@@ -39,4 +46,7 @@ private:
   VkSurfaceFormatKHR m_DefaultSurfaceFormat;
   VkExtent2D m_SwapchainExtent;
   std::vector<VkPresentModeKHR> m_SurfacePresentModes;
+
+  bool m_Headless;
+  std::vector<VkDeviceMemory> m_OffscreenMemory;
 };
@@ -7,4 +7,6 @@ class VKTexture : public Texture {
 public:
   VKImage m_Image;
   VkDescriptorSet m_TextureDescriptorSet;
+  //Same image through the biased periphery sampler
+  VkDescriptorSet m_PeripheryDescriptorSet;
 };
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "VKUploader.h"
+#include "VKError.h"
+#include <limits>
+#include <algorithm>
+
+VKUploader::VKUploader() {
+  m_Device = nullptr;
+  m_Allocator = VK_NULL_HANDLE;
+  m_RingData = nullptr;
+  m_RingSize = 0;
+  m_RingHead = 0;
+  m_RingTail = 0;
+  m_TransferPool = VK_NULL_HANDLE;
+  m_Recording = false;
+  m_BatchEmpty = true;
+  m_Current = {};
+  m_NextUpload = 1;
+  m_CompletedUpload = 0;
+}
+
+void VKUploader::Setup(VKDevice* device, VmaAllocator allocator, const VkDeviceSize ringSize) {
+  m_Device = device;
+  m_Allocator = allocator;
+  m_RingSize = ringSize;
+
+  m_Ring.Setup(m_RingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_Allocator);
+  m_RingData = static_cast<u8*>(m_Ring.Map(m_Allocator));
+
+  //Transfer command buffers need a pool of their own when they go to a different queue family
+  if (HasDedicatedQueue()) {
+    VkCommandPoolCreateInfo poolCreateInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolCreateInfo.queueFamilyIndex = m_Device->GetTransferQueueFamily();
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    VKError::CheckResult(vkCreateCommandPool(m_Device->GetDevice(), &poolCreateInfo, nullptr, &m_TransferPool), "Could not create transfer command pool");
+  }
+}
+
+void VKUploader::Destroy() {
+  Wait(Flush());
+
+  std::vector<UploadBatch> batches = m_FreeBatches;
+  if (m_Recording) {
+    batches.push_back(m_Current);
+  }
+  for (auto &batch : batches) {
+    vkDestroySemaphore(m_Device->GetDevice(), batch.mCopiesDone, nullptr);
+    vkDestroyFence(m_Device->GetDevice(), batch.mFinished, nullptr);
+    if (m_TransferPool != VK_NULL_HANDLE) {
+      vkFreeCommandBuffers(m_Device->GetDevice(), m_TransferPool, 1, &batch.mTransferCmd);
+    } else {
+      m_Device->FreeCommandBuffers({batch.mTransferCmd});
+    }
+    m_Device->FreeCommandBuffers({batch.mGraphicsCmd});
+  }
+  m_FreeBatches.clear();
+  m_Recording = false;
+
+  if (m_TransferPool != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(m_Device->GetDevice(), m_TransferPool, nullptr);
+  }
+  m_Ring.UnMap(m_Allocator);
+  m_Ring.Destroy(m_Allocator);
+}
+
+StagingRegion VKUploader::Stage(const VkDeviceSize size, const VkDeviceSize alignment) {
+  //Too big for the ring, so it gets a staging buffer of its own that is freed with the batch
+  if (size > m_RingSize) {
+    if (!m_Recording) {
+      BeginBatch();
+    }
+    m_BatchEmpty = false;
+
+    VKBuffer staging;
+    staging.Setup(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, m_Allocator);
+    //Map before storing the copy, so the stored buffer knows it has to be unmapped when the batch retires
+    void* data = staging.Map(m_Allocator);
+    m_Current.mOversizeBuffers.push_back(staging);
+    return {data, staging.GetBuffer(), 0};
+  }
+
+  u64 start;
+  while (true) {
+    //Align the offset into the ring, the ring size isn't a multiple of every alignment so the monotonic position can't be aligned
+    const u64 lap = m_RingHead / m_RingSize * m_RingSize;
+    const u64 offset = (m_RingHead - lap + alignment - 1) / alignment * alignment;
+    start = lap + offset;
+    //Data never wraps around the end of the ring, it starts over at the beginning instead
+    if (offset + size > m_RingSize) {
+      start = lap + m_RingSize;
+    }
+    if (start + size <= m_RingTail + m_RingSize) {
+      break;
+    }
+
+    if (m_RingHead == m_RingTail) {
+      //Nothing staged is still in use, so start over at the beginning of the ring
+      m_RingHead = m_RingTail = (m_RingHead + m_RingSize - 1) / m_RingSize * m_RingSize;
+    } else {
+      //Free space by waiting on the oldest batch, which is the current one if nothing else is in flight
+      if (m_InFlight.empty()) {
+        Flush();
+      }
+      Wait(m_InFlight.front().mUpload);
+    }
+  }
+
+  if (!m_Recording) {
+    BeginBatch();
+  }
+  m_BatchEmpty = false;
+  m_RingHead = start + size;
+
+  return {m_RingData + start % m_RingSize, m_Ring.GetBuffer(), start % m_RingSize};
+}
+
+VkCommandBuffer VKUploader::GetTransferCommands() {
+  if (!m_Recording) {
+    BeginBatch();
+  }
+  m_BatchEmpty = false;
+  return m_Current.mTransferCmd;
+}
+
+VkCommandBuffer VKUploader::GetGraphicsCommands() {
+  if (!m_Recording) {
+    BeginBatch();
+  }
+  m_BatchEmpty = false;
+  return m_Current.mGraphicsCmd;
+}
+
+void VKUploader::TransferOwnership(VkBuffer buffer, const VkAccessFlags dstAccess) {
+  //On a single queue family there is no owner to change, MakeVisibleToVertexInput covers visibility
+  if (!HasDedicatedQueue()) {
+    return;
+  }
+
+  VkBufferMemoryBarrier release = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+  release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  release.dstAccessMask = 0;
+  release.srcQueueFamilyIndex = m_Device->GetTransferQueueFamily();
+  release.dstQueueFamilyIndex = m_Device->GetGraphicsQueueFamily();
+  release.buffer = buffer;
+  release.offset = 0;
+  release.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(GetTransferCommands(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &release, 0, nullptr);
+
+  VkBufferMemoryBarrier acquire = release;
+  acquire.srcAccessMask = 0;
+  acquire.dstAccessMask = dstAccess;
+  vkCmdPipelineBarrier(GetGraphicsCommands(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &acquire, 0, nullptr);
+}
+
+void VKUploader::MakeVisibleToVertexInput() {
+  if (!m_Recording) {
+    BeginBatch();
+  }
+  m_BatchEmpty = false;
+  m_Current.mVertexInputBarrier = true;
+}
+
+void VKUploader::TransferOwnership(VkImage image, const u32 mipLevels) {
+  if (!HasDedicatedQueue()) {
+    return;
+  }
+
+  VkImageMemoryBarrier release = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  release.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  release.dstAccessMask = 0;
+  release.srcQueueFamilyIndex = m_Device->GetTransferQueueFamily();
+  release.dstQueueFamilyIndex = m_Device->GetGraphicsQueueFamily();
+  release.image = image;
+  release.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  release.subresourceRange.baseMipLevel = 0;
+  release.subresourceRange.levelCount = mipLevels;
+  release.subresourceRange.baseArrayLayer = 0;
+  release.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(GetTransferCommands(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release);
+
+  //The graphics side goes on to blit mips, so it picks the image up as a transfer source and destination
+  VkImageMemoryBarrier acquire = release;
+  acquire.srcAccessMask = 0;
+  acquire.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(GetGraphicsCommands(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &acquire);
+}
+
+u64 VKUploader::Flush() {
+  if (!m_Recording || m_BatchEmpty) {
+    return m_NextUpload - 1;
+  }
+
+  //Recorded last so it also covers buffers acquired from the transfer queue earlier in the batch
+  if (m_Current.mVertexInputBarrier) {
+    VkMemoryBarrier vertexInput = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    vertexInput.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vertexInput.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    vkCmdPipelineBarrier(m_Current.mGraphicsCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &vertexInput, 0, nullptr, 0, nullptr);
+  }
+
+  vkEndCommandBuffer(m_Current.mTransferCmd);
+  vkEndCommandBuffer(m_Current.mGraphicsCmd);
+  m_Current.mUpload = m_NextUpload++;
+  m_Current.mRingEnd = m_RingHead;
+
+  VkSubmitInfo copySubmit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  copySubmit.commandBufferCount = 1;
+  copySubmit.pCommandBuffers = &m_Current.mTransferCmd;
+  copySubmit.signalSemaphoreCount = 1;
+  copySubmit.pSignalSemaphores = &m_Current.mCopiesDone;
+  VKError::CheckResult(vkQueueSubmit(m_Device->GetTransferQueue(), 1, &copySubmit, VK_NULL_HANDLE), "Could not submit upload copies");
+
+  //Later graphics submissions are ordered after this wait, so anything drawn after the flush sees the uploads
+  const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  VkSubmitInfo graphicsSubmit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  graphicsSubmit.waitSemaphoreCount = 1;
+  graphicsSubmit.pWaitSemaphores = &m_Current.mCopiesDone;
+  graphicsSubmit.pWaitDstStageMask = &waitStage;
+  graphicsSubmit.commandBufferCount = 1;
+  graphicsSubmit.pCommandBuffers = &m_Current.mGraphicsCmd;
+  VKError::CheckResult(vkQueueSubmit(m_Device->GetGraphicsQueue(), 1, &graphicsSubmit, m_Current.mFinished), "Could not submit upload batch");
+
+  m_InFlight.push_back(m_Current);
+  m_Current = {};
+  m_Recording = false;
+  m_BatchEmpty = true;
+  return m_NextUpload - 1;
+}
+
+void VKUploader::Retire() {
+  while (!m_InFlight.empty() && vkGetFenceStatus(m_Device->GetDevice(), m_InFlight.front().mFinished) == VK_SUCCESS) {
+    RetireBatch(m_InFlight.front());
+    m_InFlight.pop_front();
+  }
+}
+
+bool VKUploader::IsComplete(const u64 upload) {
+  Retire();
+  return upload <= m_CompletedUpload;
+}
+
+void VKUploader::Wait(const u64 upload) {
+  if (upload >= m_NextUpload) {
+    Flush();
+  }
+  while (m_CompletedUpload < upload && !m_InFlight.empty()) {
+    vkWaitForFences(m_Device->GetDevice(), 1, &m_InFlight.front().mFinished, VK_TRUE, std::numeric_limits<u64>::max());
+    RetireBatch(m_InFlight.front());
+    m_InFlight.pop_front();
+  }
+}
+
+void VKUploader::BeginBatch() {
+  if (!m_FreeBatches.empty()) {
+    m_Current = m_FreeBatches.back();
+    m_FreeBatches.pop_back();
+  } else {
+    m_Current = {};
+    if (m_TransferPool != VK_NULL_HANDLE) {
+      VkCommandBufferAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+      allocateInfo.commandBufferCount = 1;
+      allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocateInfo.commandPool = m_TransferPool;
+      VKError::CheckResult(vkAllocateCommandBuffers(m_Device->GetDevice(), &allocateInfo, &m_Current.mTransferCmd), "Could not allocate transfer command buffer");
+    } else {
+      m_Current.mTransferCmd = m_Device->AllocateCommandBuffers(VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1)[0];
+    }
+    m_Current.mGraphicsCmd = m_Device->AllocateCommandBuffers(VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1)[0];
+
+    VkSemaphoreCreateInfo semaCreate = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    VKError::CheckResult(vkCreateSemaphore(m_Device->GetDevice(), &semaCreate, nullptr, &m_Current.mCopiesDone), "Could not create upload semaphore");
+    VkFenceCreateInfo fenceCreate = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VKError::CheckResult(vkCreateFence(m_Device->GetDevice(), &fenceCreate, nullptr, &m_Current.mFinished), "Could not create upload fence");
+  }
+
+  VkCommandBufferBeginInfo begin = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(m_Current.mTransferCmd, &begin);
+  vkBeginCommandBuffer(m_Current.mGraphicsCmd, &begin);
+
+  m_Recording = true;
+  m_BatchEmpty = true;
+}
+
+void VKUploader::RetireBatch(UploadBatch &batch) {
+  //Batches finish in order, but the ring may have been restarted past them while they were in flight
+  m_RingTail = std::max(m_RingTail, batch.mRingEnd);
+  m_CompletedUpload = batch.mUpload;
+
+  for (auto &staging : batch.mOversizeBuffers) {
+    staging.UnMap(m_Allocator);
+    staging.Destroy(m_Allocator);
+  }
+  batch.mOversizeBuffers.clear();
+
+  batch.mVertexInputBarrier = false;
+
+  vkResetFences(m_Device->GetDevice(), 1, &batch.mFinished);
+  vkResetCommandBuffer(batch.mTransferCmd, 0);
+  vkResetCommandBuffer(batch.mGraphicsCmd, 0);
+  m_FreeBatches.push_back(batch);
+}
+
+bool VKUploader::HasDedicatedQueue() {
+  return m_Device->GetTransferQueueFamily() != m_Device->GetGraphicsQueueFamily();
+}
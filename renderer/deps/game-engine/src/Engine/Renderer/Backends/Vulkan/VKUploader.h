@@ -0,0 +1,139 @@
+#pragma once
+
+#include "VKDevice.h"
+#include "VKBuffer.h"
+#include <deque>
+#include <vector>
+
+//Where staged data was written, copies read from mBuffer at mOffset
+struct StagingRegion {
+  void* mData;
+  VkBuffer mBuffer;
+  VkDeviceSize mOffset;
+};
+
+/**
+* Batches model and texture uploads through a ring of staging memory
+* Copies are recorded into the current batch and only submitted on Flush, on the transfer queue when the device has one
+* Each batch also gets a graphics command buffer that runs after its copies, for work a transfer queue can't do like mip blits
+* Batches finish in order and are tracked with fences, so staging space is reused without waiting for the queue to idle
+*/
+class VKUploader {
+public:
+  VKUploader();
+
+  /*!
+  * Creates the staging ring and the command pool for the transfer queue
+  * @param[in] device The device to upload to
+  * @param[in] allocator The allocator for staging memory
+  * @param[in] ringSize Size of the staging ring in bytes, bigger uploads get a staging buffer of their own
+  */
+  void Setup(VKDevice* device, VmaAllocator allocator, const VkDeviceSize ringSize);
+
+  /*!
+  * Waits for every batch to finish and frees everything
+  */
+  void Destroy();
+
+  /*!
+  * Reserves staging memory in the current batch, may flush and wait on older batches if the ring is full
+  * @param[in] size How many bytes will be written
+  * @param[in] alignment Alignment of the offset the copy reads from
+  * @return The mapped memory to write into and where to copy it from
+  */
+  StagingRegion Stage(const VkDeviceSize size, const VkDeviceSize alignment);
+
+  /*!
+  * Gets the current batch's transfer command buffer, for copies out of staged memory
+  */
+  VkCommandBuffer GetTransferCommands();
+
+  /*!
+  * Gets the current batch's graphics command buffer, which runs after all of the batch's copies
+  */
+  VkCommandBuffer GetGraphicsCommands();
+
+  /*!
+  * Hands a buffer written by this batch's copies over to the graphics queue
+  * @param[in] buffer The destination buffer of the copies
+  * @param[in] dstAccess How the graphics queue will access the buffer
+  */
+  void TransferOwnership(VkBuffer buffer, const VkAccessFlags dstAccess);
+
+  /*!
+  * Makes the buffers written by this batch's copies visible to vertex and index reads on the graphics queue
+  * Needed for every vertex or index buffer upload, the barrier is recorded once at the end of the batch's graphics commands
+  */
+  void MakeVisibleToVertexInput();
+
+  /*!
+  * Hands an image written by this batch's copies over to the graphics queue, it stays in transfer destination layout
+  * @param[in] image The destination image of the copies
+  * @param[in] mipLevels How many mip levels the image has
+  */
+  void TransferOwnership(VkImage image, const u32 mipLevels);
+
+  /*!
+  * Submits the current batch, nothing is submitted if nothing was recorded
+  * Graphics queue work submitted afterwards sees the uploaded data
+  * @return The batch's upload number, for IsComplete and Wait
+  */
+  u64 Flush();
+
+  /*!
+  * Frees the staging space and command buffers of every batch that has finished on the GPU, never blocks
+  */
+  void Retire();
+
+  /*!
+  * Checks if an upload batch has finished on the GPU, retiring finished batches on the way
+  * @param[in] upload The upload number returned by Flush
+  */
+  bool IsComplete(const u64 upload);
+
+  /*!
+  * Blocks until an upload batch has finished on the GPU
+  * @param[in] upload The upload number returned by Flush
+  */
+  void Wait(const u64 upload);
+
+private:
+  struct UploadBatch {
+    VkCommandBuffer mTransferCmd;
+    VkCommandBuffer mGraphicsCmd;
+    VkSemaphore mCopiesDone;
+    VkFence mFinished;
+    u64 mUpload;
+    //Ring position just past this batch's staged data
+    u64 mRingEnd;
+    //Vertex input reads have to wait on the batch's buffer copies
+    bool mVertexInputBarrier;
+    //Staging buffers made for uploads that didn't fit in the ring
+    std::vector<VKBuffer> mOversizeBuffers;
+  };
+
+  void BeginBatch();
+  void RetireBatch(UploadBatch &batch);
+  bool HasDedicatedQueue();
+
+  VKDevice* m_Device;
+  VmaAllocator m_Allocator;
+
+  VKBuffer m_Ring;
+  u8* m_RingData;
+  VkDeviceSize m_RingSize;
+  //Monotonic positions, the ring offset is the position modulo the size
+  u64 m_RingHead;
+  u64 m_RingTail;
+
+  VkCommandPool m_TransferPool;
+
+  bool m_Recording;
+  bool m_BatchEmpty;
+  UploadBatch m_Current;
+  std::deque<UploadBatch> m_InFlight;
+  std::vector<UploadBatch> m_FreeBatches;
+
+  u64 m_NextUpload;
+  u64 m_CompletedUpload;
+};
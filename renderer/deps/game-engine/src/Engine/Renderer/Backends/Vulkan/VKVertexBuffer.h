@@ -8,5 +8,13 @@ class VKVertexBuffer : public VertexBuffer {
 public:
   VkBuffer m_Buffer;
   VmaAllocation m_Allocation;
+  VkBuffer m_IndexBuffer;
   VkDeviceSize m_IndexOffset;
-};
\ No newline at end of file
+
+  //Where the mesh sits in the geometry arena, both zero for meshes with a buffer of their own
+  bool m_InArena;
+  u32 m_FirstVertex;
+  u32 m_FirstIndex;
+  u32 m_VertexCount;
+  u32 m_IndexCount;
+};
@@ -0,0 +1,123 @@
+#include "FoveationController.h"
+#include "../Config.h"
+
+#include <algorithm>
+#include <cmath>
+
+//About 90 fps
+const int DEFAULT_FRAME_BUDGET_US = 11111;
+const int DEFAULT_HYSTERESIS = 10;
+
+//Weight of the newest frame in the smoothed frame time
+const float SMOOTHING = 0.1f;
+
+//Frames to wait after a change so the smoothed time can catch up
+const u32 ADJUST_COOLDOWN = 10;
+
+//Limit how fast quality is raised again, to avoid oscillating around the budget
+const float MAX_GROWTH = 1.1f;
+
+FoveationController::FoveationController() : mEnabled(false), mBudgetUs(DEFAULT_FRAME_BUDGET_US), mHysteresis(DEFAULT_HYSTERESIS / 100.0f),
+                                             mMinSize(0), mMaxSize(0), mMinScale(0.05f), mMaxScale(1.0f), mSmoothedTimeUs(0.0f), mCooldown(0) {
+}
+
+void FoveationController::Setup(const u32 minSize, const u32 maxSize) {
+  mEnabled = Config::OptionExists("AdaptiveFoveation") && Config::GetOptionInt("AdaptiveFoveation") == 1;
+
+  if (Config::OptionExists("FrameBudgetUs")) {
+    mBudgetUs = (float)Config::GetOptionInt("FrameBudgetUs");
+  }
+
+  if (Config::OptionExists("FoveationHysteresis")) {
+    mHysteresis = Config::GetOptionInt("FoveationHysteresis") / 100.0f;
+  }
+
+  mMinSize = minSize;
+  mMaxSize = maxSize;
+
+  //Clamp before the cast so negative sizes don't wrap around
+  if (Config::OptionExists("FoveationMinSize")) {
+    mMinSize = (u32)std::max((int)minSize, std::min((int)maxSize, Config::GetOptionInt("FoveationMinSize")));
+  }
+
+  if (Config::OptionExists("FoveationMaxSize")) {
+    mMaxSize = (u32)std::max((int)minSize, std::min((int)maxSize, Config::GetOptionInt("FoveationMaxSize")));
+  }
+
+  if (mMinSize > mMaxSize) {
+    std::swap(mMinSize, mMaxSize);
+  }
+
+  if (Config::OptionExists("BaseScaleMin")) {
+    mMinScale = Config::GetOptionInt("BaseScaleMin") / 100.0f;
+  }
+
+  if (Config::OptionExists("BaseScaleMax")) {
+    mMaxScale = Config::GetOptionInt("BaseScaleMax") / 100.0f;
+  }
+
+  mMinScale = std::max(0.05f, std::min(1.0f, mMinScale));
+  mMaxScale = std::max(mMinScale, std::min(1.0f, mMaxScale));
+}
+
+void FoveationController::Update(const float gpuTimeUs, u32 &foveatedSize, float &baseResScale) {
+  if (!mEnabled || gpuTimeUs <= 0.0f) {
+    return;
+  }
+
+  if (mSmoothedTimeUs == 0.0f) {
+    mSmoothedTimeUs = gpuTimeUs;
+  } else {
+    mSmoothedTimeUs += SMOOTHING * (gpuTimeUs - mSmoothedTimeUs);
+  }
+
+  if (mCooldown > 0) {
+    mCooldown--;
+    return;
+  }
+
+  //Pixel cost scales with area, so change the side lengths by the square root of the time ratio
+  const float ratio = std::sqrt(mBudgetUs / mSmoothedTimeUs);
+
+  const u32 oldSize = foveatedSize;
+  const float oldScale = baseResScale;
+
+  //Base pass scale changes are kept to whole percents so the resolution doesn't creep by fractions of a pixel
+  if (mSmoothedTimeUs > mBudgetUs * (1.0f + mHysteresis)) {
+    if (baseResScale > mMinScale) {
+      baseResScale = std::max(mMinScale, std::floor(baseResScale * ratio * 100.0f) / 100.0f);
+    } else {
+      foveatedSize = std::max(mMinSize, (u32)(foveatedSize * ratio));
+    }
+  } else if (mSmoothedTimeUs < mBudgetUs * (1.0f - mHysteresis)) {
+    const float growth = std::min(ratio, MAX_GROWTH);
+
+    if (foveatedSize < mMaxSize) {
+      foveatedSize = std::min(mMaxSize, std::max(foveatedSize + 1, (u32)(foveatedSize * growth)));
+    } else if (baseResScale < mMaxScale) {
+      baseResScale = std::min(mMaxScale, std::ceil(baseResScale * growth * 100.0f) / 100.0f);
+    }
+  }
+
+  if (foveatedSize != oldSize || baseResScale != oldScale) {
+    mCooldown = ADJUST_COOLDOWN;
+  }
+}
+
+bool FoveationController::IsEnabled() const {
+  return mEnabled;
+}
+
+void FoveationController::SetEnabled(const bool enabled) {
+  mEnabled = enabled;
+  mSmoothedTimeUs = 0.0f;
+  mCooldown = 0;
+}
+
+float FoveationController::GetBudget() const {
+  return mBudgetUs;
+}
+
+float FoveationController::GetSmoothedTime() const {
+  return mSmoothedTimeUs;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../CommonTypes.h"
+
+/**
+* Keeps the GPU frame time inside a budget by trading off foveation quality
+* When over budget the base pass resolution is lowered first, then the foveated square is shrunk
+* When under budget the foveated square is grown first, then the base pass resolution is raised
+* Nothing changes while the frame time is inside the hysteresis band around the budget
+*/
+class FoveationController {
+public:
+  FoveationController();
+
+  /*!
+  * Reads the controller settings from the config
+  * @param[in] minSize The smallest allowed foveated square size, in pixels
+  * @param[in] maxSize The largest allowed foveated square size, in pixels
+  */
+  void Setup(const u32 minSize, const u32 maxSize);
+
+  /*!
+  * Feeds the controller the GPU time of the last finished frame and adjusts the foveation settings
+  * @param[in] gpuTimeUs The measured GPU frame time, in microseconds
+  * @param[in] foveatedSize The current foveated square size, replaced by the new size
+  * @param[in] baseResScale The current base pass resolution scale from 0 to 1, replaced by the new scale
+  */
+  void Update(const float gpuTimeUs, u32 &foveatedSize, float &baseResScale);
+
+  bool IsEnabled() const;
+  void SetEnabled(const bool enabled);
+
+  float GetBudget() const;
+  float GetSmoothedTime() const;
+
+private:
+  bool mEnabled;
+
+  float mBudgetUs;
+  float mHysteresis;
+
+  u32 mMinSize;
+  u32 mMaxSize;
+  float mMinScale;
+  float mMaxScale;
+
+  float mSmoothedTimeUs;
+  u32 mCooldown;
+};
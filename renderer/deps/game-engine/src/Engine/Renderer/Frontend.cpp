@@ -3,12 +3,15 @@
 #include "../Log.h"
 #include "../Config.h"
 #include "../FileLoader.h"
+#include "MeshSimplifier.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
 #include <fstream>
+#include <limits>
+#include <algorithm>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../stb_image.h"
@@ -24,6 +27,12 @@ const std::string frameBufferFragFile = "fbo.frag";
 
 const u32 MAX_UI_LAYER = 50;
 
+//Meshes smaller than this aren't worth simplifying
+const u32 MIN_LOD_FACES = 512;
+
+//Frames of timings shown in the Render Info graphs
+const u32 TIMING_HISTORY_SIZE = 120;
+
 RenderBackend* RenderFrontend::m_Backend = nullptr;
 
 std::map<std::string, ModelTree> RenderFrontend::mLoadedModels;
@@ -44,10 +53,15 @@ Shader* RenderFrontend::m_SpriteShader = nullptr;
 Model RenderFrontend::m_UIModel;
 
 bool RenderFrontend::m_DrawUI = true;
+bool RenderFrontend::m_ShaderLOD = false;
+bool RenderFrontend::m_MeshLOD = false;
 Mat4 RenderFrontend::m_ShaderUserData = Mat4(0.0f);
 Mat4 RenderFrontend::m_AspectMatrix = Mat4(1.0f);
 DirectionalLightData RenderFrontend::m_DirectionalData = {Vec4(0.0f), Vec4(0.0f), Vec4(0.0f), Vec4(0.0f)};
 
+std::vector<FrameTimings> RenderFrontend::m_TimingHistory(TIMING_HISTORY_SIZE);
+u32 RenderFrontend::m_TimingHistoryOffset = 0;
+
 static Mat4 AssimpMat4ToMat4(const aiMatrix4x4& aiMatrix) {
   return Mat4(aiMatrix.a1, aiMatrix.b1, aiMatrix.c1, aiMatrix.d1,
               aiMatrix.a2, aiMatrix.b2, aiMatrix.c2, aiMatrix.d2,
@@ -84,6 +98,9 @@ void RenderFrontend::Init() {
     m_DrawUI = true;
   }
 
+  m_ShaderLOD = Config::OptionExists("ShaderLOD") && Config::GetOptionInt("ShaderLOD") == 1;
+  m_MeshLOD = Config::OptionExists("MeshLOD") && Config::GetOptionInt("MeshLOD") == 1;
+
   m_Backend->Init();
 
   m_Backend->WindowInit("Foveated Rendering", mScreenX, mScreenY);
@@ -182,10 +199,14 @@ ModelTree RenderFrontend::LoadModel(const std::string &file) {
     Model model;
     //Copy all vertex positions/normals
     std::vector<Vertex> vertices(mesh->mNumVertices);
+    Vec3 boundsMin = Vec3(std::numeric_limits<float>::max());
+    Vec3 boundsMax = Vec3(std::numeric_limits<float>::lowest());
     for (size_t i = 0; i < vertices.size(); i++) {
       vertices[i].mPosition.x = mesh->mVertices[i].x;
       vertices[i].mPosition.y = mesh->mVertices[i].y;
       vertices[i].mPosition.z = mesh->mVertices[i].z;
+      boundsMin = glm::min(boundsMin, vertices[i].mPosition);
+      boundsMax = glm::max(boundsMax, vertices[i].mPosition);
       vertices[i].mNormal.x = mesh->mNormals[i].x;
       vertices[i].mNormal.y = mesh->mNormals[i].y;
       vertices[i].mNormal.z = mesh->mNormals[i].z;
@@ -216,14 +237,52 @@ ModelTree RenderFrontend::LoadModel(const std::string &file) {
       indices[(3 * i) + 2] = mesh->mFaces[i].mIndices[2];
     }
 
+    //Build the level of detail chain, each level is appended to the same index buffer
+    MeshLOD lods[MAX_MESH_LODS];
+    u32 numLODs = 0;
+    if (m_MeshLOD && mesh->mNumFaces >= MIN_LOD_FACES) {
+      const std::vector<u32> fullIndices = indices;
+      lods[numLODs++] = {0, mesh->mNumFaces, 0.0f};
+
+      while (numLODs < MAX_MESH_LODS) {
+        const MeshLOD &previous = lods[numLODs - 1];
+        float lodError;
+        std::vector<u32> lodIndices = SimplifyMesh(vertices, fullIndices, previous.mNumFaces / 2, lodError);
+        const u32 lodFaces = (u32)(lodIndices.size() / 3);
+
+        //Stop once the simplifier can't make meaningful progress
+        if (lodFaces == 0 || lodFaces > (3 * previous.mNumFaces) / 4) {
+          break;
+        }
+        lods[numLODs] = {(u32)indices.size(), lodFaces, std::max(lodError, previous.mError)};
+        numLODs++;
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+      }
+
+      if (numLODs == 1) {
+        numLODs = 0;
+      }
+    }
+
     //Copy data to GPU
     model = m_Backend->LoadModel(vertices, indices);
     model.mNumFaces = mesh->mNumFaces;
+    model.mNumLODs = numLODs;
+    std::copy(lods, lods + numLODs, model.mLODs);
+
+    //Compute a bounding sphere for culling
+    if (!vertices.empty()) {
+      model.mBoundsCenter = 0.5f * (boundsMin + boundsMax);
+      for (const auto &v : vertices) {
+        model.mBoundsRadius = std::max(model.mBoundsRadius, glm::length(v.mPosition - model.mBoundsCenter));
+      }
+    }
     models.push_back(model);
   }
 
   modelTree.mMeshes = models;
   modelTree.mShader = nullptr;
+  modelTree.mPeripheralShader = nullptr;
 
   modelTree.mRoot = std::make_shared<Node>();
   //Copy root node
@@ -343,7 +402,29 @@ std::vector<char> RenderFrontend::LoadShaderFile(const std::string &file) {
   return data;
 }
 
+bool RenderFrontend::ShaderFileExists(const std::string &file) {
+  auto path = FileLoader::GetRootPath();
+  path.append("shaders");
+  path.append(m_Backend->GetShaderFolderName());
+  path.append(file);
+
+  std::ifstream shaderFile(path, std::ios::binary);
+  return !shaderFile.fail();
+}
+
 Shader* RenderFrontend::LoadShader(const std::string &vertexFile, const std::string &fragmentFile, const DRAW_STAGE stage) {
+  return LoadShader(vertexFile, fragmentFile, stage, false);
+}
+
+Shader* RenderFrontend::LoadShaderAsync(const std::string &vertexFile, const std::string &fragmentFile, const DRAW_STAGE stage) {
+  return LoadShader(vertexFile, fragmentFile, stage, true);
+}
+
+bool RenderFrontend::IsShaderReady(Shader* shader) {
+  return m_Backend->IsShaderReady(shader);
+}
+
+Shader* RenderFrontend::LoadShader(const std::string &vertexFile, const std::string &fragmentFile, const DRAW_STAGE stage, const bool async) {
   u32 stage_idx = static_cast<u32>(stage);
   auto it = mLoadedShaders.find(vertexFile + fragmentFile + std::to_string(stage_idx));
   if (it != mLoadedShaders.end()) {
@@ -352,11 +433,32 @@ Shader* RenderFrontend::LoadShader(const std::string &vertexFile, const std::str
   std::vector<char> vertexData = LoadShaderFile(vertexFile);
   std::vector<char> fragmentData = LoadShaderFile(fragmentFile);
 
-  Shader* s = m_Backend->CreateShader(vertexData, fragmentData, stage);
+  Shader* s = async ? m_Backend->CreateShaderAsync(vertexData, fragmentData, stage) : m_Backend->CreateShader(vertexData, fragmentData, stage);
   mLoadedShaders.insert(std::pair<std::string, Shader*>(vertexFile + fragmentFile + std::to_string(stage_idx), s));
   return s;
 }
 
+Shader* RenderFrontend::LoadShaderVariant(const std::string &vertexFile, const std::string &fragmentFile, const std::string &variant, const DRAW_STAGE stage, const bool async) {
+  if (!m_ShaderLOD) {
+    return nullptr;
+  }
+
+  //Variants sit next to the full shader, e.g. static_entity.frag -> static_entity_periphery.frag
+  std::string variantFile = fragmentFile;
+  auto extension = variantFile.rfind('.');
+  if (extension == std::string::npos) {
+    variantFile.append("_" + variant);
+  } else {
+    variantFile.insert(extension, "_" + variant);
+  }
+
+  if (!ShaderFileExists(variantFile)) {
+    Log::LogWarning("Missing shader variant " + variantFile + ", using " + fragmentFile);
+    return nullptr;
+  }
+  return LoadShader(vertexFile, variantFile, stage, async);
+}
+
 void RenderFrontend::SetShaderUserData(const Mat4 &value) {
   m_ShaderUserData = value;
 }
@@ -394,9 +496,13 @@ void RenderFrontend::DrawSprites(const std::vector<Texture *> &sprites, const st
   for (u32 i = 0; i < sprites.size(); i++) {
     Drawable d;
     d.mShader = isText ? m_TextShader : m_SpriteShader;
+    d.mPeripheralShader = nullptr;
+    d.mNumLODs = 0;
     d.mVBuffer = m_UIModel.mVBuffer;
     d.mNumFaces = m_UIModel.mNumFaces;
     d.mTexture = sprites[i];
+    d.mBoundsCenter = m_UIModel.mBoundsCenter;
+    d.mBoundsRadius = m_UIModel.mBoundsRadius;
 
     float layer = (float)transforms[i].layer / MAX_UI_LAYER;
     float depth = 0.5f;
@@ -455,6 +561,31 @@ void RenderFrontend::EndFrame() {
     ImGui::Text("# 3D Models: %u", mWorldToDraw.size());
   }
 
+  //Keep the timings even while the graphs are hidden, so they are full when opened
+  m_TimingHistory[m_TimingHistoryOffset] = m_Backend->GetFrameTimings();
+  m_TimingHistoryOffset = (m_TimingHistoryOffset + 1) % TIMING_HISTORY_SIZE;
+
+  if (ImGui::CollapsingHeader("Frame Timings")) {
+    const FrameTimings &latest = m_TimingHistory[(m_TimingHistoryOffset + TIMING_HISTORY_SIZE - 1) % TIMING_HISTORY_SIZE];
+    const std::pair<const char*, const float FrameTimings::*> graphs[] = {
+      {"CPU Draw", &FrameTimings::mCPUDraw},
+      {"GPU Total", &FrameTimings::mGPUTotal},
+      {"Shadow", &FrameTimings::mGPUShadow},
+      {"World", &FrameTimings::mGPUWorld},
+      {"Foveated", &FrameTimings::mGPUFoveated},
+      {"UI", &FrameTimings::mGPUUI},
+      {"Present", &FrameTimings::mGPUPresent}
+    };
+
+    //Timings are in microseconds, graphs are labelled in milliseconds and start at zero
+    for (const auto &graph : graphs) {
+      char overlay[32];
+      snprintf(overlay, sizeof(overlay), "%.2fms", latest.*graph.second / 1000.0f);
+      ImGui::PlotLines(graph.first, &(m_TimingHistory[0].*graph.second), TIMING_HISTORY_SIZE, m_TimingHistoryOffset,
+                       overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f), sizeof(FrameTimings));
+    }
+  }
+
   LightData lights;
   lights.mDirectionalLight = m_DirectionalData;
 
@@ -488,15 +619,41 @@ const IVec2 RenderFrontend::GetScreenResolution() {
 DEPTH_MODE RenderFrontend::GetDepthMode() {
   return m_Backend->GetDepthMode();
 }
+
+FrameTimings RenderFrontend::GetFrameTimings() {
+  return m_Backend->GetFrameTimings();
+}
+
+void RenderFrontend::SetFoveationEnabled(const bool enabled) {
+  m_Backend->SetFoveationEnabled(enabled);
+}
+
+void RenderFrontend::ResetTemporalState() {
+  m_Backend->ResetTemporalState();
+}
+
+void RenderFrontend::RequestFrameCapture() {
+  m_Backend->RequestFrameCapture();
+}
+
+bool RenderFrontend::GetFrameCapture(FrameCapture &capture) {
+  return m_Backend->GetFrameCapture(capture);
+}
+
 void RenderFrontend::DrawNode(const ModelTree &modeltree, const std::shared_ptr<Node> &node, const Mat4& parentTransform) {
 
   for (u32 i = 0; i < node->mMeshIndices.size(); i++) {
     Drawable d;
 
     d.mShader = modeltree.mShader;
+    d.mPeripheralShader = modeltree.mPeripheralShader;
     d.mVBuffer = modeltree.mMeshes[node->mMeshIndices[i]].mVBuffer;
     d.mNumFaces = modeltree.mMeshes[node->mMeshIndices[i]].mNumFaces;
     d.mTexture = modeltree.mMeshes[node->mMeshIndices[i]].mTexture;
+    d.mBoundsCenter = modeltree.mMeshes[node->mMeshIndices[i]].mBoundsCenter;
+    d.mBoundsRadius = modeltree.mMeshes[node->mMeshIndices[i]].mBoundsRadius;
+    d.mNumLODs = modeltree.mMeshes[node->mMeshIndices[i]].mNumLODs;
+    std::copy(modeltree.mMeshes[node->mMeshIndices[i]].mLODs, modeltree.mMeshes[node->mMeshIndices[i]].mLODs + d.mNumLODs, d.mLODs);
 
     d.mTransformMatrix = parentTransform * node->mTransformMatrix;
     mWorldToDraw.push_back(d);
@@ -61,6 +61,33 @@ public:
   */
   static Shader* LoadShader(const std::string &vertexFile, const std::string &fragmentFile, const DRAW_STAGE stage);
 
+  /*!
+  * Same as LoadShader, but the pipeline is built on a worker thread so this returns straight away
+  * Drawables using the shader fall back to their other shader, or are skipped, until it is ready
+  * @param[in] vertexFile The vertex shader file name to load, relative to the data folder
+  * @param[in] fragmentFile The frament shader file name to load, relative to the data folder
+  * @return The handle to the shader, which may not be ready yet
+  */
+  static Shader* LoadShaderAsync(const std::string &vertexFile, const std::string &fragmentFile, const DRAW_STAGE stage);
+
+  /*!
+  * Checks if a shader's pipeline has finished building
+  * @param[in] shader The shader handle
+  * @return True once the shader can be drawn with
+  */
+  static bool IsShaderReady(Shader* shader);
+
+  /*!
+  * Loads a cheaper variant of a shader, named <fragment>_<variant>.frag
+  * Only loaded when the ShaderLOD option is set
+  * @param[in] vertexFile The vertex shader file name to load, relative to the data folder
+  * @param[in] fragmentFile The full fragment shader file name the variant is based on
+  * @param[in] variant The suffix of the variant, e.g. "periphery"
+  * @param[in] async Build the variant on a worker thread, the full shader is used until it is ready
+  * @return The handle to the variant shader, or nullptr if disabled or missing
+  */
+  static Shader* LoadShaderVariant(const std::string &vertexFile, const std::string &fragmentFile, const std::string &variant, const DRAW_STAGE stage, const bool async = false);
+
   /*!
   * Sets the user data uniform in the given shader object
   * @param[in] value The Mat4 value to set
@@ -136,6 +163,36 @@ public:
   * @return The backen's depth mode
   */
   static DEPTH_MODE GetDepthMode();
+
+  /*!
+  * Gets the CPU and GPU timings of the last frame the backend finished
+  * @return The timings in microseconds
+  */
+  static FrameTimings GetFrameTimings();
+
+  /*!
+  * Turns foveated rendering on or off, the debug UI can still change it afterwards
+  * @param[in] enabled Whether to render with foveation
+  */
+  static void SetFoveationEnabled(const bool enabled);
+
+  /*!
+  * Drops everything carried over from earlier frames, so the next frame is rendered as if it were the first
+  * That is the reprojected base pass history, the reused foveated image and the saccade state
+  */
+  static void ResetTemporalState();
+
+  /*!
+  * Asks the backend to read back the next frame it draws
+  */
+  static void RequestFrameCapture();
+
+  /*!
+  * Gets the last requested frame, waiting for the GPU to finish it
+  * @param[out] capture The frame's pixels and gaze point
+  * @return Whether a frame was captured since the last request
+  */
+  static bool GetFrameCapture(FrameCapture &capture);
 private:
   static RenderBackend* m_Backend;
 
@@ -158,10 +215,14 @@ private:
   static std::vector<Drawable> mUIToDraw;
 
   static std::vector<char> LoadShaderFile(const std::string &file);
+  static Shader* LoadShader(const std::string &vertexFile, const std::string &fragmentFile, const DRAW_STAGE stage, const bool async);
+  static bool ShaderFileExists(const std::string &file);
 
   static void DrawNode(const ModelTree &modeltree, const std::shared_ptr<Node>& node, const Mat4& parentTransform);
 
   static bool m_DrawUI;
+  static bool m_ShaderLOD;
+  static bool m_MeshLOD;
   static Mat4 m_ShaderUserData;
 
   static Shader* m_TextShader;
@@ -171,4 +232,8 @@ private:
   static Mat4 m_AspectMatrix;
   
   static DirectionalLightData m_DirectionalData;
+
+  //Rolling history of frame timings for the Render Info graphs, m_TimingHistoryOffset is the oldest entry
+  static std::vector<FrameTimings> m_TimingHistory;
+  static u32 m_TimingHistoryOffset;
 };
\ No newline at end of file
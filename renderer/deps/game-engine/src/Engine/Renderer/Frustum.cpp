@@ -0,0 +1,56 @@
+#include "Frustum.h"
+
+#include <algorithm>
+
+void Frustum::Setup(const Mat4 &viewProj) {
+  //glm matrices are column major, so build the rows first
+  Vec4 rows[4];
+  for (u32 i = 0; i < 4; i++) {
+    rows[i] = Vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+  }
+
+  mPlanes[0] = rows[3] + rows[0]; //Left
+  mPlanes[1] = rows[3] - rows[0]; //Right
+  mPlanes[2] = rows[3] + rows[1]; //Bottom
+  mPlanes[3] = rows[3] - rows[1]; //Top
+  mPlanes[4] = rows[2];           //Near (zero to one depth)
+  mPlanes[5] = rows[3] - rows[2]; //Far
+
+  for (auto &plane : mPlanes) {
+    float length = glm::length(Vec3(plane));
+    if (length > 0.0f) {
+      plane /= length;
+    }
+  }
+}
+
+bool Frustum::IntersectsSphere(const Vec3 &center, const float radius) const {
+  for (const auto &plane : mPlanes) {
+    if (glm::dot(Vec3(plane), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Mat4 GetSubProjection(const Mat4 &proj, const Vec2 &ndcMin, const Vec2 &ndcMax) {
+  Vec2 size = ndcMax - ndcMin;
+
+  //Scale and shift the clip space so the rectangle fills the whole view
+  Mat4 crop = Mat4(1.0f);
+  crop[0][0] = 2.0f / size.x;
+  crop[1][1] = 2.0f / size.y;
+  crop[3][0] = -(ndcMax.x + ndcMin.x) / size.x;
+  crop[3][1] = -(ndcMax.y + ndcMin.y) / size.y;
+
+  return crop * proj;
+}
+
+void TransformSphere(const Mat4 &transform, Vec3 &center, float &radius) {
+  center = Vec3(transform * Vec4(center, 1.0f));
+
+  //Use the largest axis scale so the sphere stays conservative under non-uniform scaling
+  float scale = std::max(glm::length(Vec3(transform[0])),
+                         std::max(glm::length(Vec3(transform[1])), glm::length(Vec3(transform[2]))));
+  radius *= scale;
+}
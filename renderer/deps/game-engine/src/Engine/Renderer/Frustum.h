@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../CommonTypes.h"
+
+/**
+* View frustum stored as six inward facing planes
+* Each plane is stored as (normal.x, normal.y, normal.z, distance)
+*/
+class Frustum {
+public:
+  /*!
+  * Extracts the frustum planes from a combined projection * view matrix
+  * The projection is expected to use a zero to one depth range
+  * @param[in] viewProj The combined projection * view matrix
+  */
+  void Setup(const Mat4 &viewProj);
+
+  /*!
+  * Tests a world space bounding sphere against the frustum
+  * @param[in] center The center of the sphere
+  * @param[in] radius The radius of the sphere
+  * @return True if any part of the sphere may be inside the frustum
+  */
+  bool IntersectsSphere(const Vec3 &center, const float radius) const;
+
+private:
+  Vec4 mPlanes[6];
+};
+
+/*!
+* Builds a projection matrix covering only a sub rectangle of another projection's view
+* The rectangle is mapped to the full -1 to 1 NDC range of the returned projection
+* @param[in] proj The original projection matrix
+* @param[in] ndcMin The minimum corner of the rectangle, in the original NDC space
+* @param[in] ndcMax The maximum corner of the rectangle, in the original NDC space
+* @return The off-center projection matrix
+*/
+Mat4 GetSubProjection(const Mat4 &proj, const Vec2 &ndcMin, const Vec2 &ndcMax);
+
+/*!
+* Transforms an object space bounding sphere into world space
+* @param[in] transform The object's model matrix
+* @param[in] center The object space center of the sphere, replaced by the world space center
+* @param[in] radius The object space radius, replaced by the world space radius
+*/
+void TransformSphere(const Mat4 &transform, Vec3 &center, float &radius);
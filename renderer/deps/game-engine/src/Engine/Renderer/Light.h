@@ -6,6 +6,11 @@ struct DirectionalLightData {
   Vec4 m_DiffuseColor;
   Vec4 m_SpecularColor;
   Mat4 m_LightSpaceMatrix;
+
+  //Tighter shadow cascade around the gaze point, m_GazeShadowRect is its part of the shadow map as (u offset, v offset, u scale, v scale)
+  //A zero scale means there is no gaze cascade
+  Mat4 m_GazeLightSpaceMatrix;
+  Vec4 m_GazeShadowRect;
 };
 
 struct LightData {
@@ -0,0 +1,278 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+
+//Boundary edges get extra weight so open borders don't shrink
+const double BOUNDARY_WEIGHT = 10.0;
+
+//Collapses that turn a triangle further than this (cosine of the angle between normals) are rejected
+const double MIN_NORMAL_DOT = 0.25;
+
+/**
+* Sum of squared distances to a set of planes, stored as the upper half of a symmetric 4x4 matrix
+*/
+struct Quadric {
+  double a2, ab, ac, ad;
+  double b2, bc, bd;
+  double c2, cd;
+  double d2;
+};
+
+struct Collapse {
+  double cost;
+  u32 from;
+  u32 to;
+};
+
+struct PositionHash {
+  size_t operator()(const Vec3 &p) const {
+    std::hash<float> hasher;
+    size_t seed = hasher(p.x);
+    seed ^= hasher(p.y) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= hasher(p.z) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+  }
+};
+
+static void AddPlane(Quadric &q, const glm::dvec3 &normal, const double distance, const double weight) {
+  q.a2 += weight * normal.x * normal.x;
+  q.ab += weight * normal.x * normal.y;
+  q.ac += weight * normal.x * normal.z;
+  q.ad += weight * normal.x * distance;
+  q.b2 += weight * normal.y * normal.y;
+  q.bc += weight * normal.y * normal.z;
+  q.bd += weight * normal.y * distance;
+  q.c2 += weight * normal.z * normal.z;
+  q.cd += weight * normal.z * distance;
+  q.d2 += weight * distance * distance;
+}
+
+static void AddQuadric(Quadric &dst, const Quadric &src) {
+  dst.a2 += src.a2; dst.ab += src.ab; dst.ac += src.ac; dst.ad += src.ad;
+  dst.b2 += src.b2; dst.bc += src.bc; dst.bd += src.bd;
+  dst.c2 += src.c2; dst.cd += src.cd;
+  dst.d2 += src.d2;
+}
+
+static double EvaluateQuadric(const Quadric &q, const Vec3 &position) {
+  const double x = position.x, y = position.y, z = position.z;
+  double result = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x
+                + q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y
+                + q.c2 * z * z + 2.0 * q.cd * z
+                + q.d2;
+  return std::max(result, 0.0);
+}
+
+static u64 EdgeKey(const u32 a, const u32 b) {
+  return a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a;
+}
+
+std::vector<u32> SimplifyMesh(const std::vector<Vertex> &vertices, const std::vector<u32> &indices, const u32 targetFaces, float &error) {
+  error = 0.0f;
+  u32 faceCount = (u32)(indices.size() / 3);
+  if (faceCount <= targetFaces) {
+    return indices;
+  }
+
+  //Weld vertices that share a position, the first one found stands in for the rest
+  const u32 vertexCount = (u32)vertices.size();
+  std::vector<u32> remap(vertexCount);
+  std::unordered_map<Vec3, u32, PositionHash> positions;
+  for (u32 i = 0; i < vertexCount; i++) {
+    auto inserted = positions.insert(std::pair<Vec3, u32>(vertices[i].mPosition, i));
+    remap[i] = inserted.first->second;
+  }
+
+  //Collapses work on the welded indices, the original corners are kept so untouched seams keep their attributes
+  std::vector<u32> corners = indices;
+  std::vector<u32> result(indices.size());
+  for (u32 i = 0; i < indices.size(); i++) {
+    result[i] = remap[indices[i]];
+  }
+
+  //Each vertex starts with the planes of the triangles around it
+  std::vector<Quadric> quadrics(vertexCount, Quadric{});
+  std::vector<std::pair<u64, u32>> edges;
+  edges.reserve(result.size());
+  for (u32 t = 0; t < faceCount; t++) {
+    const u32 *tri = &result[3 * t];
+    glm::dvec3 p0 = vertices[tri[0]].mPosition;
+    glm::dvec3 p1 = vertices[tri[1]].mPosition;
+    glm::dvec3 p2 = vertices[tri[2]].mPosition;
+    glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+    double length = glm::length(normal);
+    if (length <= 0.0) {
+      continue;
+    }
+    normal /= length;
+    for (u32 c = 0; c < 3; c++) {
+      AddPlane(quadrics[tri[c]], normal, -glm::dot(normal, p0), 1.0);
+      edges.push_back(std::pair<u64, u32>(EdgeKey(tri[c], tri[(c + 1) % 3]), t));
+    }
+  }
+
+  //Edges used by only one triangle are on a border, hold them in place with a plane perpendicular to the face
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size();) {
+    size_t run = i + 1;
+    while (run < edges.size() && edges[run].first == edges[i].first) {
+      run++;
+    }
+    if (run - i == 1) {
+      const u32 *tri = &result[3 * edges[i].second];
+      const u32 a = (u32)(edges[i].first >> 32);
+      const u32 b = (u32)(edges[i].first & 0xffffffff);
+      glm::dvec3 pa = vertices[a].mPosition;
+      glm::dvec3 pb = vertices[b].mPosition;
+      glm::dvec3 faceNormal = glm::cross(glm::dvec3(vertices[tri[1]].mPosition) - glm::dvec3(vertices[tri[0]].mPosition),
+                                         glm::dvec3(vertices[tri[2]].mPosition) - glm::dvec3(vertices[tri[0]].mPosition));
+      glm::dvec3 normal = glm::cross(pb - pa, faceNormal);
+      double length = glm::length(normal);
+      if (length > 0.0) {
+        normal /= length;
+        AddPlane(quadrics[a], normal, -glm::dot(normal, pa), BOUNDARY_WEIGHT);
+        AddPlane(quadrics[b], normal, -glm::dot(normal, pa), BOUNDARY_WEIGHT);
+      }
+    }
+    i = run;
+  }
+
+  std::vector<u32> collapseTarget(vertexCount);
+  std::vector<bool> locked(vertexCount);
+  std::vector<u32> triangleOffsets(vertexCount + 1);
+  std::vector<u32> vertexTriangles;
+  std::vector<Collapse> collapses;
+  double maxCost = 0.0;
+
+  //Collapse the cheapest independent edges in passes until the target is reached or nothing can be removed
+  while (faceCount > targetFaces) {
+    //Build the vertex to triangle adjacency for this pass
+    std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+    for (const auto index : result) {
+      triangleOffsets[index + 1]++;
+    }
+    for (u32 i = 0; i < vertexCount; i++) {
+      triangleOffsets[i + 1] += triangleOffsets[i];
+    }
+    vertexTriangles.resize(result.size());
+    std::vector<u32> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (u32 i = 0; i < result.size(); i++) {
+      vertexTriangles[fill[result[i]]++] = i / 3;
+    }
+
+    //Find every unique edge and the cheaper way to collapse it
+    std::vector<u64> edgeKeys;
+    edgeKeys.reserve(result.size());
+    for (u32 i = 0; i < result.size(); i += 3) {
+      for (u32 c = 0; c < 3; c++) {
+        edgeKeys.push_back(EdgeKey(result[i + c], result[i + (c + 1) % 3]));
+      }
+    }
+    std::sort(edgeKeys.begin(), edgeKeys.end());
+    edgeKeys.erase(std::unique(edgeKeys.begin(), edgeKeys.end()), edgeKeys.end());
+
+    collapses.clear();
+    for (const auto key : edgeKeys) {
+      const u32 a = (u32)(key >> 32);
+      const u32 b = (u32)(key & 0xffffffff);
+      Quadric q = quadrics[a];
+      AddQuadric(q, quadrics[b]);
+      double costA = EvaluateQuadric(q, vertices[a].mPosition);
+      double costB = EvaluateQuadric(q, vertices[b].mPosition);
+      if (costA < costB) {
+        collapses.push_back({costA, b, a});
+      } else {
+        collapses.push_back({costB, a, b});
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse &l, const Collapse &r) { return l.cost < r.cost; });
+
+    for (u32 i = 0; i < vertexCount; i++) {
+      collapseTarget[i] = i;
+    }
+    std::fill(locked.begin(), locked.end(), false);
+
+    u32 removedFaces = 0;
+    for (const auto &collapse : collapses) {
+      if (faceCount - removedFaces <= targetFaces) {
+        break;
+      }
+      if (locked[collapse.from] || locked[collapse.to]) {
+        continue;
+      }
+
+      //Reject collapses that would flip or badly fold a triangle
+      bool valid = true;
+      u32 removed = 0;
+      const Vec3 &newPosition = vertices[collapse.to].mPosition;
+      for (u32 j = triangleOffsets[collapse.from]; j < triangleOffsets[collapse.from + 1] && valid; j++) {
+        const u32 *tri = &result[3 * vertexTriangles[j]];
+        if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+          removed++;
+          continue;
+        }
+
+        glm::dvec3 before[3], after[3];
+        for (u32 c = 0; c < 3; c++) {
+          before[c] = vertices[tri[c]].mPosition;
+          after[c] = tri[c] == collapse.from ? newPosition : vertices[tri[c]].mPosition;
+        }
+        glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        double lengths = glm::length(normalBefore) * glm::length(normalAfter);
+        if (lengths <= 0.0 || glm::dot(normalBefore, normalAfter) < MIN_NORMAL_DOT * lengths) {
+          valid = false;
+        }
+      }
+      if (!valid) {
+        continue;
+      }
+
+      //Lock the neighbourhood so later collapses in this pass are checked against up to date triangles
+      for (u32 j = triangleOffsets[collapse.from]; j < triangleOffsets[collapse.from + 1]; j++) {
+        const u32 *tri = &result[3 * vertexTriangles[j]];
+        locked[tri[0]] = locked[tri[1]] = locked[tri[2]] = true;
+      }
+      locked[collapse.to] = true;
+
+      collapseTarget[collapse.from] = collapse.to;
+      AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+      maxCost = std::max(maxCost, collapse.cost);
+      removedFaces += removed;
+    }
+
+    if (removedFaces == 0) {
+      break;
+    }
+
+    //Move collapsed corners and drop the triangles that became degenerate
+    u32 writeIndex = 0;
+    for (u32 i = 0; i < result.size(); i += 3) {
+      u32 a = collapseTarget[result[i]];
+      u32 b = collapseTarget[result[i + 1]];
+      u32 c = collapseTarget[result[i + 2]];
+      if (a == b || b == c || a == c) {
+        continue;
+      }
+      for (u32 k = 0; k < 3; k++) {
+        if (collapseTarget[result[i + k]] != result[i + k]) {
+          corners[i + k] = collapseTarget[result[i + k]];
+        }
+        corners[writeIndex + k] = corners[i + k];
+      }
+      result[writeIndex++] = a;
+      result[writeIndex++] = b;
+      result[writeIndex++] = c;
+    }
+    result.resize(writeIndex);
+    corners.resize(writeIndex);
+    faceCount = writeIndex / 3;
+  }
+
+  //The quadric sums squared distances to many planes, so its root bounds the distance to any one of them
+  error = (float)std::sqrt(maxCost);
+  return corners;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Types.h"
+
+#include <vector>
+
+/*!
+* Reduces a triangle mesh using quadric error metric edge collapses
+* Vertices are never moved or added, so the result indexes into the same vertex array
+* Vertices sharing a position are collapsed together, keeping attribute seams closed
+* @param[in] vertices The vertex array of the mesh
+* @param[in] indices The triangle list to simplify
+* @param[in] targetFaces The number of triangles to stop at
+* @param[out] error Estimate of the largest object space distance the surface moved
+* @return The simplified triangle list, which may have more faces than targetFaces if the mesh can't be reduced further
+*/
+std::vector<u32> SimplifyMesh(const std::vector<Vertex> &vertices, const std::vector<u32> &indices, const u32 targetFaces, float &error);
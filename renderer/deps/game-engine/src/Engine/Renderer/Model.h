@@ -10,12 +10,32 @@
 class VertexBuffer {
 };
 
+const u32 MAX_MESH_LODS = 4;
+
+/**
+* A range of the model's index buffer drawing the mesh at a reduced level of detail
+*/
+struct MeshLOD {
+  u32 mFirstIndex;
+  u32 mNumFaces;
+  //Object space distance the surface may have moved from the full detail mesh
+  float mError;
+};
+
 class Model {
 public:
-  Model() : mVBuffer(nullptr), mTexture(nullptr) {}
+  Model() : mVBuffer(nullptr), mTexture(nullptr), mNumFaces(0), mBoundsCenter(0.0f), mBoundsRadius(0.0f), mNumLODs(0) {}
   VertexBuffer* mVBuffer;
   Texture * mTexture;
   u32 mNumFaces;
+
+  //Object space bounding sphere, computed once when the model is loaded
+  Vec3 mBoundsCenter;
+  float mBoundsRadius;
+
+  //Detail levels from full to coarsest, empty if the model only has the full mesh
+  u32 mNumLODs;
+  MeshLOD mLODs[MAX_MESH_LODS];
 };
 
 class Node {
@@ -28,6 +48,8 @@ public:
 class ModelTree {
 public:
   Shader* mShader;
+  //Cheaper shader for meshes drawn outside the fovea, nullptr to always use mShader
+  Shader* mPeripheralShader;
   std::shared_ptr<Node> mRoot;
   std::vector<Model> mMeshes;
 };
@@ -0,0 +1,47 @@
+#include "BenchCamera.h"
+#include <algorithm>
+#include <cmath>
+
+BenchCamera::BenchCamera() {
+  //Same view as the player gets
+  mCamera.SetPosition(Vec3(0.0f, 0.0f, 0.0f));
+  mCamera.SetFOV(BENCH_FOV_DEGREES * M_PI / 180.0f);
+  mCamera.SetScreenShader("camera.vert", "camera.frag");
+  mCamera.SetUserData(glm::mat4(0.0f));
+  mCamera.SetAsMainCamera();
+}
+
+BenchCamera::~BenchCamera() {
+
+}
+
+void BenchCamera::SetPath(const std::vector<BenchWaypoint> &path) {
+  mPath = path;
+}
+
+void BenchCamera::SetProgress(const float progress) {
+  const float t = std::max(0.0f, std::min(1.0f, progress));
+
+  //Without a path, look all the way around from where the player starts
+  if (mPath.empty()) {
+    const float angle = -M_PI / 2 + t * 2.0f * M_PI;
+    mCamera.SetPosition(Vec3(0.0f, 0.0f, 0.0f));
+    mCamera.SetViewTarget(Vec3(std::cos(angle), 0.0f, std::sin(angle)));
+    return;
+  }
+
+  if (mPath.size() == 1) {
+    mCamera.SetPosition(mPath[0].position);
+    mCamera.SetViewTarget(mPath[0].target);
+    return;
+  }
+
+  const float segment = t * (mPath.size() - 1);
+  const u32 index = std::min((u32)segment, (u32)mPath.size() - 2);
+  const float blend = segment - index;
+
+  const BenchWaypoint &from = mPath[index];
+  const BenchWaypoint &to = mPath[index + 1];
+  mCamera.SetPosition(glm::mix(from.position, to.position, blend));
+  mCamera.SetViewTarget(glm::mix(from.target, to.target, blend));
+}
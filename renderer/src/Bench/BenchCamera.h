@@ -0,0 +1,42 @@
+#ifndef BENCH_CAMERA_H
+#define BENCH_CAMERA_H
+
+#include <GameObject.h>
+#include <Components/CameraComponent.h>
+#include <vector>
+
+//Vertical field of view, the same as the player's
+const float BENCH_FOV_DEGREES = 65.0f;
+
+struct BenchWaypoint {
+  Vec3 position;
+  Vec3 target;
+};
+
+/**
+ * Moves the main camera along a scripted path for benchmark runs
+ * The camera is placed by frame number instead of elapsed time, so every run sees the same views
+ */
+class BenchCamera : public GameObject {
+public:
+  BenchCamera();
+  ~BenchCamera();
+
+  /**
+   * Sets the path to follow, an empty path turns on the spot at the origin
+   * @param[in] path The waypoints to move between at an even pace
+   */
+  void SetPath(const std::vector<BenchWaypoint> &path);
+
+  /**
+   * Places the camera along the path
+   * @param[in] progress How far along the path to go, from 0 to 1
+   */
+  void SetProgress(const float progress);
+
+private:
+  CameraComponent mCamera;
+  std::vector<BenchWaypoint> mPath;
+};
+
+#endif //BENCH_CAMERA_H
@@ -0,0 +1,79 @@
+#include "ImageQuality.h"
+#include <vector>
+#include <cmath>
+
+//8x8 windows stepped by half a window, with the usual SSIM constants for 8 bit images
+const u32 SSIM_WINDOW = 8;
+const u32 SSIM_STEP = 4;
+const float SSIM_C1 = (0.01f * 255.0f) * (0.01f * 255.0f);
+const float SSIM_C2 = (0.03f * 255.0f) * (0.03f * 255.0f);
+
+//Eccentricity in degrees at which visual acuity has halved
+const float HALF_ACUITY_ECCENTRICITY = 2.3f;
+
+static std::vector<float> GetLuminance(const FrameCapture &frame) {
+  std::vector<float> luminance(frame.mWidth * frame.mHeight);
+  for (size_t i = 0; i < luminance.size(); i++) {
+    const u8* pixel = &frame.mPixels[i * 4];
+    luminance[i] = 0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2];
+  }
+  return luminance;
+}
+
+QualityScore CompareFrames(const FrameCapture &reference, const FrameCapture &test, const float pixelsPerDegree) {
+  QualityScore score = {0.0f, 0.0f};
+  if (reference.mWidth != test.mWidth || reference.mHeight != test.mHeight ||
+      reference.mWidth < SSIM_WINDOW || reference.mHeight < SSIM_WINDOW) {
+    return score;
+  }
+
+  const std::vector<float> x = GetLuminance(reference);
+  const std::vector<float> y = GetLuminance(test);
+  const u32 width = reference.mWidth;
+  const float windowPixels = (float)(SSIM_WINDOW * SSIM_WINDOW);
+
+  double ssimSum = 0.0;
+  double weightedSum = 0.0;
+  double weightSum = 0.0;
+  u32 windows = 0;
+
+  for (u32 top = 0; top + SSIM_WINDOW <= reference.mHeight; top += SSIM_STEP) {
+    for (u32 left = 0; left + SSIM_WINDOW <= width; left += SSIM_STEP) {
+      float sumX = 0.0f, sumY = 0.0f, sumXX = 0.0f, sumYY = 0.0f, sumXY = 0.0f;
+      for (u32 row = top; row < top + SSIM_WINDOW; row++) {
+        for (u32 col = left; col < left + SSIM_WINDOW; col++) {
+          const float a = x[row * width + col];
+          const float b = y[row * width + col];
+          sumX += a;
+          sumY += b;
+          sumXX += a * a;
+          sumYY += b * b;
+          sumXY += a * b;
+        }
+      }
+
+      const float meanX = sumX / windowPixels;
+      const float meanY = sumY / windowPixels;
+      const float varX = sumXX / windowPixels - meanX * meanX;
+      const float varY = sumYY / windowPixels - meanY * meanY;
+      const float covariance = sumXY / windowPixels - meanX * meanY;
+      const float ssim = ((2.0f * meanX * meanY + SSIM_C1) * (2.0f * covariance + SSIM_C2)) /
+                         ((meanX * meanX + meanY * meanY + SSIM_C1) * (varX + varY + SSIM_C2));
+
+      //Weight falls off with eccentricity the way acuity does
+      const float centerX = left + SSIM_WINDOW / 2.0f - test.mGaze.x;
+      const float centerY = top + SSIM_WINDOW / 2.0f - test.mGaze.y;
+      const float eccentricity = std::sqrt(centerX * centerX + centerY * centerY) / pixelsPerDegree;
+      const float weight = HALF_ACUITY_ECCENTRICITY / (HALF_ACUITY_ECCENTRICITY + eccentricity);
+
+      ssimSum += ssim;
+      weightedSum += weight * ssim;
+      weightSum += weight;
+      windows++;
+    }
+  }
+
+  score.ssim = (float)(ssimSum / windows);
+  score.foveatedSsim = (float)(weightedSum / weightSum);
+  return score;
+}
@@ -0,0 +1,23 @@
+#ifndef IMAGE_QUALITY_H
+#define IMAGE_QUALITY_H
+
+#include <Renderer/Backend.h>
+
+struct QualityScore {
+  //Mean SSIM over the whole frame
+  float ssim;
+  //SSIM weighted by how sharply each part of the frame is seen from the gaze point
+  float foveatedSsim;
+};
+
+/**
+ * Compares a frame against a reference rendered from the same view, with SSIM on luminance
+ * The foveated score weights each window by cortical magnification, so errors in the periphery count for less
+ * @param[in] reference The frame rendered without foveation
+ * @param[in] test The frame to score, its gaze point is used for the weighting
+ * @param[in] pixelsPerDegree How many pixels make up one degree of visual angle
+ * @return Both scores, from -1 to 1 where 1 is identical
+ */
+QualityScore CompareFrames(const FrameCapture &reference, const FrameCapture &test, const float pixelsPerDegree);
+
+#endif //IMAGE_QUALITY_H
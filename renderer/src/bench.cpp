@@ -0,0 +1,258 @@
+#include <EngineCore.h>
+#include <CommandArgs.h>
+#include <Config.h>
+#include <FileLoader.h>
+#include <InputManager.h>
+#include <Log.h>
+#include <Renderer/Frontend.h>
+#include <Renderer/Backends/Vulkan/GazeTrace.h>
+#include <SDL_timer.h>
+#include <json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include "Bench/BenchCamera.h"
+#include "Bench/ImageQuality.h"
+
+using json = nlohmann::json;
+
+const u32 DEFAULT_BENCH_FRAMES = 600;
+const u32 DEFAULT_WARMUP_FRAMES = 60;
+const u32 DEFAULT_QUALITY_FRAMES = 30;
+const std::string DEFAULT_OUTPUT = "bench.json";
+
+//Every frame's timings for one map, in milliseconds
+struct MapSamples {
+  std::vector<float> frame;
+  std::vector<float> cpuDraw;
+  std::vector<float> cpuShadow;
+  std::vector<float> cpuWorld;
+  std::vector<float> cpuFoveated;
+  std::vector<float> cpuUI;
+  std::vector<float> cpuPresent;
+  std::vector<float> gpu;
+  std::vector<float> gpuShadow;
+  std::vector<float> gpuWorld;
+  std::vector<float> gpuFoveated;
+  std::vector<float> gpuUI;
+  std::vector<float> gpuPresent;
+};
+
+static u32 GetOptionOr(const std::string &option, const u32 fallback) {
+  return Config::OptionExists(option) ? (u32)std::max(1, Config::GetOptionInt(option)) : fallback;
+}
+
+//Nearest rank percentile of sorted samples
+static float Percentile(const std::vector<float> &sorted, const float p) {
+  size_t rank = (size_t)std::ceil(p / 100.0f * sorted.size());
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+static json Percentiles(std::vector<float> samples) {
+  json result;
+  if (samples.empty()) {
+    return result;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  result["p50"] = Percentile(samples, 50.0f);
+  result["p95"] = Percentile(samples, 95.0f);
+  result["p99"] = Percentile(samples, 99.0f);
+  return result;
+}
+
+//Quality gets worse downwards, so report the mean and the low tail
+static json QualityStats(std::vector<float> samples) {
+  json result;
+  if (samples.empty()) {
+    return result;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  float sum = 0.0f;
+  for (const float sample : samples) {
+    sum += sample;
+  }
+  result["mean"] = sum / samples.size();
+  result["p5"] = Percentile(samples, 5.0f);
+  result["min"] = samples.front();
+  return result;
+}
+
+//Renders each view once without and once with foveation, then scores the foveated frame against the full one
+//Both frames of a pair see the same camera and gaze, and neither reuses anything from earlier frames
+static json MeasureQuality(EngineCore* core, BenchCamera* camera, const u32 qualityFrames) {
+  std::vector<float> ssim;
+  std::vector<float> foveatedSsim;
+
+  for (u32 i = 0; i < qualityFrames && !Input::GetClose(); i++) {
+    camera->SetProgress(qualityFrames > 1 ? (float)i / (qualityFrames - 1) : 0.0f);
+
+    FrameCapture reference;
+    RenderFrontend::SetFoveationEnabled(false);
+    RenderFrontend::ResetTemporalState();
+    RenderFrontend::RequestFrameCapture();
+    core->RunFrame();
+    const bool haveReference = RenderFrontend::GetFrameCapture(reference);
+
+    //Keep the reference frame's gaze and replayed camera for the foveated frame
+    GazeTrace::SetPaused(true);
+    GazePointManager::SetPaused(true);
+
+    FrameCapture foveated;
+    RenderFrontend::SetFoveationEnabled(true);
+    RenderFrontend::ResetTemporalState();
+    RenderFrontend::RequestFrameCapture();
+    core->RunFrame();
+    const bool haveFoveated = RenderFrontend::GetFrameCapture(foveated);
+
+    GazeTrace::SetPaused(false);
+    GazePointManager::SetPaused(false);
+
+    if (haveReference && haveFoveated) {
+      const QualityScore score = CompareFrames(reference, foveated, foveated.mHeight / BENCH_FOV_DEGREES);
+      ssim.push_back(score.ssim);
+      foveatedSsim.push_back(score.foveatedSsim);
+    }
+  }
+
+  json result;
+  result["frames"] = (u32)ssim.size();
+  result["ssim"] = QualityStats(ssim);
+  result["foveatedSsim"] = QualityStats(foveatedSsim);
+  return result;
+}
+
+static Vec3 JsonToVec3(const json &value) {
+  return Vec3(value.at("x").get<float>(), value.at("y").get<float>(), value.at("z").get<float>());
+}
+
+//Maps can list a "benchPath" of positions and view targets, otherwise the camera turns around at the start point
+static std::vector<BenchWaypoint> LoadPath(const std::string &mapPath) {
+  std::vector<BenchWaypoint> path;
+
+  std::ifstream mapFile(mapPath);
+  json mapJson;
+  mapFile >> mapJson;
+
+  if (mapJson.find("benchPath") != mapJson.end()) {
+    for (const auto &waypoint : mapJson.at("benchPath").get<std::vector<json>>()) {
+      path.push_back({JsonToVec3(waypoint.at("position")), JsonToVec3(waypoint.at("target"))});
+    }
+  }
+  return path;
+}
+
+int main(int argc, char** argv) {
+  Config::LoadFile("config.txt");
+  CommandArgs::ParseArgs(argc, argv);
+
+  //The scripted path drives the camera, a replayed gaze trace only drives the gaze and repeats for as long as needed
+  if (!Config::OptionExists("GazeReplayCamera")) {
+    Config::AddOption("GazeReplayCamera", "0");
+  }
+  if (!Config::OptionExists("GazeReplayLoop")) {
+    Config::AddOption("GazeReplayLoop", "1");
+  }
+
+  const u32 benchFrames = GetOptionOr("BenchFrames", DEFAULT_BENCH_FRAMES);
+  const u32 warmupFrames = GetOptionOr("BenchWarmupFrames", DEFAULT_WARMUP_FRAMES);
+  const std::string output = Config::OptionExists("BenchOutput") ? Config::GetOptionString("BenchOutput") : DEFAULT_OUTPUT;
+  const bool measureQuality = Config::OptionExists("BenchQuality") && Config::GetOptionInt("BenchQuality") == 1;
+  const u32 qualityFrames = GetOptionOr("BenchQualityFrames", DEFAULT_QUALITY_FRAMES);
+
+  EngineCore* core = EngineCore::GetEngine();
+  BenchCamera* camera = core->SpawnObject<BenchCamera>();
+
+  //Run the map given on the command line, or every map in the data folder
+  std::vector<std::string> maps;
+  if (!CommandArgs::GetMapToLoad().empty()) {
+    maps.push_back(CommandArgs::GetMapToLoad());
+  } else {
+    for (const auto &file : std::experimental::filesystem::directory_iterator(FileLoader::GetFilePath("maps"))) {
+      if (file.path().extension().string() == ".map") {
+        maps.push_back(file.path().generic_string());
+      }
+    }
+    std::sort(maps.begin(), maps.end());
+  }
+
+  json results;
+  results["unit"] = "ms";
+  results["frames"] = benchFrames;
+  results["warmupFrames"] = warmupFrames;
+  results["maps"] = json::array();
+
+  for (const auto &map : maps) {
+    core->GetMap()->LoadMap(map, false);
+    camera->SetPath(LoadPath(map));
+    GazeTrace::Rewind();
+
+    //GPU timings arrive a few frames late, so keep going until the last timed frame has been read back
+    MapSamples samples;
+    const u32 gpuLatency = RenderFrontend::GetFrameTimings().mGPULatency;
+    const u32 totalFrames = warmupFrames + benchFrames + gpuLatency;
+    for (u32 i = 0; i < totalFrames && !Input::GetClose(); i++) {
+      camera->SetProgress(i < warmupFrames ? 0.0f : (float)(i - warmupFrames) / benchFrames);
+
+      const u64 frameStart = SDL_GetPerformanceCounter();
+      core->RunFrame();
+      const float frameTime = (float)((SDL_GetPerformanceCounter() - frameStart) * 1000.0 / SDL_GetPerformanceFrequency());
+
+      const FrameTimings timings = RenderFrontend::GetFrameTimings();
+      if (i >= warmupFrames && i < warmupFrames + benchFrames) {
+        samples.frame.push_back(frameTime);
+        samples.cpuDraw.push_back(timings.mCPUDraw / 1000.0f);
+        samples.cpuShadow.push_back(timings.mCPUShadow / 1000.0f);
+        samples.cpuWorld.push_back(timings.mCPUWorld / 1000.0f);
+        samples.cpuFoveated.push_back(timings.mCPUFoveated / 1000.0f);
+        samples.cpuUI.push_back(timings.mCPUUI / 1000.0f);
+        samples.cpuPresent.push_back(timings.mCPUPresent / 1000.0f);
+      }
+      if (i >= warmupFrames + gpuLatency) {
+        samples.gpu.push_back(timings.mGPUTotal / 1000.0f);
+        samples.gpuShadow.push_back(timings.mGPUShadow / 1000.0f);
+        samples.gpuWorld.push_back(timings.mGPUWorld / 1000.0f);
+        samples.gpuFoveated.push_back(timings.mGPUFoveated / 1000.0f);
+        samples.gpuUI.push_back(timings.mGPUUI / 1000.0f);
+        samples.gpuPresent.push_back(timings.mGPUPresent / 1000.0f);
+      }
+    }
+
+    if (Input::GetClose()) {
+      Log::LogWarning("Benchmark closed before finishing " + map);
+      break;
+    }
+
+    json mapResult;
+    mapResult["map"] = std::experimental::filesystem::path(map).filename().string();
+    mapResult["frameTime"] = Percentiles(samples.frame);
+    mapResult["cpuDraw"] = Percentiles(samples.cpuDraw);
+    mapResult["cpuShadow"] = Percentiles(samples.cpuShadow);
+    mapResult["cpuWorld"] = Percentiles(samples.cpuWorld);
+    mapResult["cpuFoveated"] = Percentiles(samples.cpuFoveated);
+    mapResult["cpuUI"] = Percentiles(samples.cpuUI);
+    mapResult["cpuPresent"] = Percentiles(samples.cpuPresent);
+    mapResult["gpu"] = Percentiles(samples.gpu);
+    mapResult["gpuShadow"] = Percentiles(samples.gpuShadow);
+    mapResult["gpuWorld"] = Percentiles(samples.gpuWorld);
+    mapResult["gpuFoveated"] = Percentiles(samples.gpuFoveated);
+    mapResult["gpuUI"] = Percentiles(samples.gpuUI);
+    mapResult["gpuPresent"] = Percentiles(samples.gpuPresent);
+
+    //Runs after the timed frames so the extra captures don't show up in them
+    if (measureQuality) {
+      mapResult["quality"] = MeasureQuality(core, camera, qualityFrames);
+    }
+    results["maps"].push_back(mapResult);
+
+    Log::LogInfo("Benchmarked " + map);
+  }
+
+  std::ofstream outputFile(output);
+  outputFile << results.dump(2) << std::endl;
+  Log::LogInfo("Wrote benchmark results to " + output);
+
+  delete core;
+  return 0;
+}